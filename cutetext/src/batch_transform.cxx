@@ -0,0 +1,140 @@
+// This file is part of CuteText project
+// Copyright (C) 2026 by the CuteText contributors
+// The LICENSE file describes the conditions under which this software may be distributed.
+/**
+ * @file batch_transform.cxx
+ * @date 2026-10-18
+ * @brief Implementation of text transformations applied to files without a user interface.
+ *
+ * These functions only touch their arguments so that many files may be
+ * processed at once on separate threads.
+ *
+ * @see https://github.com/cutetext/cutetext
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "HeadlessDocument.h"
+
+#include "gui.h"
+#include "string_helpers.h"
+#include "filepath.h"
+#include "batch_transform.h"
+
+using Scintilla::Document;
+using Scintilla::HeadlessDocument;
+
+namespace {
+
+bool IsSpaceOrTab(char ch) noexcept {
+	return (ch == ' ') || (ch == '\t');
+}
+
+std::string CreateIndentation(Sci::Position column, int tabSize, bool useTabs) {
+	std::string indentation;
+	if (useTabs) {
+		indentation.append(column / tabSize, '\t');
+		column = column % tabSize;
+	}
+	indentation.append(column, ' ');
+	return indentation;
+}
+
+// Rewrite the indentation and trailing spaces of each line. Lines are visited
+// from the end so each edit only moves text after the lines still to be visited.
+bool TransformLines(Document *pdoc, const BatchOptions &options) {
+	bool changed = false;
+	for (Sci::Line line = pdoc->LinesTotal() - 1; line >= 0; line--) {
+		const Sci::Position lineStart = pdoc->LineStart(line);
+		Sci::Position lineEnd = pdoc->LineEnd(line);
+		if (options.stripTrailingSpaces) {
+			Sci::Position contentEnd = lineEnd;
+			while ((contentEnd > lineStart) && IsSpaceOrTab(pdoc->CharAt(contentEnd - 1)))
+				contentEnd--;
+			if (contentEnd < lineEnd) {
+				pdoc->DeleteChars(contentEnd, lineEnd - contentEnd);
+				lineEnd = contentEnd;
+				changed = true;
+			}
+		}
+		// A line emptied by stripping stays empty rather than regaining its indentation.
+		if (options.convertIndentation && (lineEnd > lineStart)) {
+			const Sci::Position indentEnd = pdoc->GetLineIndentPosition(line);
+			const std::string indentation = CreateIndentation(pdoc->GetLineIndentation(line),
+				pdoc->tabInChars, options.useTabs);
+			std::string current(indentEnd - lineStart, '\0');
+			pdoc->GetCharRange(&current[0], lineStart, current.length());
+			if (current != indentation) {
+				pdoc->DeleteChars(lineStart, indentEnd - lineStart);
+				pdoc->InsertString(lineStart, indentation.c_str(), indentation.length());
+				changed = true;
+			}
+		}
+	}
+	return changed;
+}
+
+}
+
+bool BatchTransformText(std::string &text, const BatchOptions &options) {
+	HeadlessDocument doc;
+	doc.LoadText(text.c_str(), text.length());
+	Document *pdoc = doc.GetDocument();
+	pdoc->tabInChars = (options.tabSize > 0) ? options.tabSize : 8;
+	bool changed = false;
+	if (!options.find.empty()) {
+		changed = doc.ReplaceAll(options.find.c_str(), options.replace.c_str(), SCFIND_MATCHCASE) > 0;
+	}
+	if (options.convertLineEnds) {
+		doc.ConvertLineEnds(options.eolMode);
+		// ConvertLineEnds does not report whether it changed anything.
+		changed = changed || (doc.Text() != text);
+	}
+	if (options.convertIndentation || options.stripTrailingSpaces) {
+		changed = TransformLines(pdoc, options) || changed;
+	}
+	if (changed) {
+		text = doc.Text();
+	}
+	return changed;
+}
+
+void BatchTransformFile(const BatchOptions &options, BatchFileResult &result) {
+	GUI::ElapsedTime fileTime;
+	std::string text = result.path.Read();
+	result.changed = BatchTransformText(text, options);
+	if (result.changed) {
+		FILE *fp = result.path.Open(fileWrite);
+		if (fp) {
+			const size_t written = fwrite(text.c_str(), 1, text.length(), fp);
+			result.failed = (fclose(fp) != 0) || (written != text.length());
+		} else {
+			result.failed = true;
+		}
+	}
+	result.duration = fileTime.Duration();
+}
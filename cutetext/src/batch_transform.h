@@ -0,0 +1,46 @@
+// This file is part of CuteText project
+// Copyright (C) 2026 by the CuteText contributors
+// The LICENSE file describes the conditions under which this software may be distributed.
+/**
+ * @file batch_transform.h
+ * @date 2026-10-18
+ * @brief Definition of text transformations applied to files without a user interface.
+ *
+ * @see https://github.com/cutetext/cutetext
+ */
+
+#ifndef BATCHTRANSFORM_H
+#define BATCHTRANSFORM_H
+
+/// Settings for transforming one file, resolved from properties before processing.
+struct BatchOptions {
+	bool convertLineEnds;
+	int eolMode;            ///< One of SC_EOL_CRLF, SC_EOL_CR, SC_EOL_LF
+	bool convertIndentation;
+	bool useTabs;
+	int tabSize;
+	bool stripTrailingSpaces;
+	std::string find;       ///< Literal text to replace; nothing is replaced when empty
+	std::string replace;
+	BatchOptions() : convertLineEnds(false), eolMode(SC_EOL_LF), convertIndentation(false),
+		useTabs(true), tabSize(8), stripTrailingSpaces(false) {
+	}
+};
+
+/// Outcome of transforming one file.
+struct BatchFileResult {
+	FilePath path;
+	bool changed;
+	bool failed;
+	double duration;
+	BatchFileResult() : changed(false), failed(false), duration(0.0) {
+	}
+};
+
+/// Apply the options to text, returning true when the text was changed.
+bool BatchTransformText(std::string &text, const BatchOptions &options);
+
+/// Read, transform and, if changed, write back one file.
+void BatchTransformFile(const BatchOptions &options, BatchFileResult &result);
+
+#endif
@@ -49,6 +49,8 @@
 #include "cookie.h"
 #include "worker.h"
 #include "fileworker.h"
+#include "job_runner.h"
+#include "find_worker.h"
 #include "match_marker.h"
 #include "editor_config.h"
 #include "cutetext_base.h"
@@ -149,6 +151,9 @@ CuteTextBase::CuteTextBase(Extension *ext) : apis_(true), pwFocussed_(&wEditor_)
 	allowMenuActions_ = true;
 	scrollOutput_ = 1;
 	returnOutputToCommand_ = true;
+	queueRunner_ = nullptr;
+	queueNext_ = 0;
+	queueOutputStart_ = 0;
 
 	ptStartDrag_.x_ = 0;
 	ptStartDrag_.y_ = 0;
@@ -201,6 +206,7 @@ CuteTextBase::CuteTextBase(Extension *ext) : apis_(true), pwFocussed_(&wEditor_)
 
 	timerMask_ = 0;
 	delayBeforeAutoSave_ = 0;
+	sessionSavedTime_ = 0;
 
 	editorConfig_ = IEditorConfig::Create();
 }
@@ -213,6 +219,18 @@ CuteTextBase::~CuteTextBase() {
 
 void CuteTextBase::Finalise() {
 	TimerEnd(kTimerAutoSave);
+	// Every tool is killed before waiting for any so they end together, then
+	// the runners are only freed once their threads have finished with them.
+	for (std::unique_ptr<JobRunner> &runner : jobRunners_) {
+		runner->RequestCancel();
+	}
+	for (std::unique_ptr<JobRunner> &runner : jobRunners_) {
+		if (!runner->FinishedJob())
+			runner->Cancel();
+	}
+	jobRunners_.clear();
+	queueRunner_ = nullptr;
+	StopFindInBackground();
 }
 
 void CuteTextBase::WorkerCommand(int cmd, Worker *pWorker) {
@@ -228,6 +246,21 @@ void CuteTextBase::WorkerCommand(int cmd, Worker *pWorker) {
 	case kWorkFileProgress:
  		UpdateProgress(pWorker);
 		break;
+	case kWorkJobOutput:
+		// Posts from runners already freed by Finalise are dropped.
+		if (JobRunner *runner = FindJobRunner(pWorker))
+			JobRunnerOutput(runner);
+		break;
+	case kWorkJobCompleted:
+		if (JobRunner *runner = FindJobRunner(pWorker))
+			JobRunnerCompleted(runner);
+		break;
+	case kWorkFindHits:
+		FindWorkerHits(static_cast<FindWorker *>(pWorker));
+		break;
+	case kWorkFindCompleted:
+		FindWorkerCompleted(static_cast<FindWorker *>(pWorker));
+		break;
 	}
 }
 
@@ -940,6 +973,7 @@ static std::string UnSlashAsNeeded(const std::string &s, bool escapes, bool regu
 
 void CuteTextBase::RemoveFindMarks() {
 	findMarker.Stop();	// Cancel ongoing background find
+	StopFindInBackground();
 	if (CurrentBuffer()->findMarks != Buffer::kFmNone) {
 		wEditor_.Call(SCI_SETINDICATORCURRENT, kIndicatorMatch);
 		wEditor_.Call(SCI_INDICATORCLEARRANGE, 0, LengthDocument());
@@ -983,12 +1017,117 @@ void CuteTextBase::MarkAll(MarkPurpose purpose) {
 		return;
 	}
 
+	if (purpose == kMarkIncremental) {
+		// Reuse the matches found for the text typed so far
+		findMarker.StartIncrementalMatch(&wEditor_, findTarget,
+			SearchFlags(regExp), kIndicatorMatch);
+		SetIdler(true);
+		return;
+	}
+
+	const int bookMark = (purpose == kMarkWithBookMarks) ? kMarkerBookmark : -1;
+	if (FindInBackground(findTarget, SearchFlags(regExp), 0, false, bookMark))
+		return;
 	findMarker.StartMatch(&wEditor_, findTarget,
 		SearchFlags(regExp), -1,
-		kIndicatorMatch, (purpose == kMarkWithBookMarks) ? kMarkerBookmark : -1);
+		kIndicatorMatch, bookMark);
 	SetIdler(true);
 }
 
+/**
+ * Search a snapshot of the document on a worker thread when it is too large to search
+ * without freezing the editor. Only plain text is searched this way so false is
+ * returned for searches that must be performed by Scintilla.
+ */
+bool CuteTextBase::FindInBackground(const std::string &findTarget, int flags, int startPosition, bool firstOnly, int bookMark) {
+	const int sizeBackground = props_.GetInt("find.background.size", 16 * 1024 * 1024);
+	const int lengthDocument = LengthDocument();
+	if ((sizeBackground <= 0) || (lengthDocument < sizeBackground))
+		return false;
+	const int codePage = wEditor_.Call(SCI_GETCODEPAGE);
+	if (((codePage != 0) && (codePage != SC_CP_UTF8)) || !FindWorker::CanSearch(findTarget, flags, codePage))
+		return false;
+	StopFindInBackground();
+	// The worker classifies characters exactly as Scintilla currently does.
+	std::string wordCharacters(wEditor_.Call(SCI_GETWORDCHARS), '\0');
+	if (wordCharacters.length())
+		wEditor_.CallPointer(SCI_GETWORDCHARS, 0, &wordCharacters[0]);
+	std::string whitespaceCharacters(wEditor_.Call(SCI_GETWHITESPACECHARS), '\0');
+	if (whitespaceCharacters.length())
+		wEditor_.CallPointer(SCI_GETWHITESPACECHARS, 0, &whitespaceCharacters[0]);
+	// A snapshot shares unchanged text with the previous one so repeated searches copy little.
+	ITextSnapshot *snapshot = reinterpret_cast<ITextSnapshot *>(wEditor_.CallReturnPointer(SCI_CREATETEXTSNAPSHOT));
+	findWorker_ = std::make_unique<FindWorker>(this, snapshot, findTarget, flags, codePage,
+		wordCharacters, whitespaceCharacters, startPosition, wrapFind, firstOnly, bookMark);
+	if (!PerformOnNewThread(findWorker_.get())) {
+		findWorker_.reset();
+		return false;
+	}
+	return true;
+}
+
+bool CuteTextBase::FindNextInBackground(bool reverseDirection) {
+	if (reverseDirection || findInStyle || (findWhat.length() == 0))
+		return false;
+	const std::string findTarget = UnSlashAsNeeded(EncodeString(findWhat), unSlash, regExp);
+	const Sci_CharacterRange cr = GetSelection();
+	return FindInBackground(findTarget, SearchFlags(regExp), static_cast<int>(cr.cpMax), true, -1);
+}
+
+/**
+ * Cancel any background search. Edits, switching buffers and a new search all stop it
+ * as the positions it finds would no longer match the document.
+ */
+void CuteTextBase::StopFindInBackground() {
+	if (findWorker_) {
+		if (!findWorker_->FinishedJob())
+			findWorker_->Cancel();
+		// Its completion message may still be queued so keep it until that arrives.
+		findWorkersStopping_.push_back(std::move(findWorker_));
+	}
+}
+
+void CuteTextBase::FindWorkerHits(FindWorker *finder) {
+	if (finder != findWorker_.get())
+		return;	// Cancelled
+	// Every match found since the last call is handled at once.
+	const std::vector<FindHit> hits = finder->TakeHits();
+	if (hits.empty())
+		return;
+	if (finder->firstOnly) {
+		if (hits[0].start < finder->startPosition)
+			WarnUser(kWarnFindWrapped);
+		havefound = true;
+		failedfind = false;
+		ShowFound(hits[0].start, hits[0].end);
+		return;
+	}
+	wEditor_.Call(SCI_SETINDICATORCURRENT, kIndicatorMatch);
+	for (const FindHit &hit : hits) {
+		wEditor_.Call(SCI_INDICATORFILLRANGE, hit.start, hit.end - hit.start);
+		if (finder->bookMark >= 0) {
+			wEditor_.Call(SCI_MARKERADD, wEditor_.Call(SCI_LINEFROMPOSITION, hit.start), finder->bookMark);
+		}
+	}
+}
+
+void CuteTextBase::FindWorkerCompleted(FindWorker *finder) {
+	if (finder == findWorker_.get()) {
+		FindWorkerHits(finder);
+		if (finder->firstOnly && (finder->found == 0)) {
+			havefound = false;
+			failedfind = true;
+			WarnUser(kWarnNotFound);
+			FindMessageBox("Can not find the string '^0'.", &findWhat);
+		}
+		findWorker_.reset();
+	} else {
+		findWorkersStopping_.erase(std::remove_if(findWorkersStopping_.begin(), findWorkersStopping_.end(),
+			[finder](const std::unique_ptr<FindWorker> &candidate) { return candidate.get() == finder; }),
+			findWorkersStopping_.end());
+	}
+}
+
 int CuteTextBase::IncrementSearchMode() {
 	FindIncrement();
 	return 0;
@@ -1106,24 +1245,26 @@ int CuteTextBase::FindNext(bool reverseDirection, bool showWarnings, bool allowR
 	} else {
 		havefound = true;
 		failedfind = false;
-		const int start = wEditor_.Call(SCI_GETTARGETSTART);
-		const int end = wEditor_.Call(SCI_GETTARGETEND);
-		// Ensure found text is styled so that caret will be made visible.
-		const int endStyled = wEditor_.Call(SCI_GETENDSTYLED);
-		if (endStyled < end)
-			wEditor_.Call(SCI_COLOURISE, endStyled,
-				wEditor_.LineStart(wEditor_.LineFromPosition(end) + 1));
-		EnsureRangeVisible(wEditor_, start, end);
-		wEditor_.Call(SCI_SCROLLRANGE, start, end);
-		wEditor_.Call(SCI_SETTARGETRANGE, start, end);
-		SetSelection(start, end);
-		if (!replacing && (closeFind != CloseFind::kClosePrevent)) {
-			DestroyFindReplace();
-		}
+		ShowFound(wEditor_.Call(SCI_GETTARGETSTART), wEditor_.Call(SCI_GETTARGETEND));
 	}
 	return posFind;
 }
 
+void CuteTextBase::ShowFound(int start, int end) {
+	// Ensure found text is styled so that caret will be made visible.
+	const int endStyled = wEditor_.Call(SCI_GETENDSTYLED);
+	if (endStyled < end)
+		wEditor_.Call(SCI_COLOURISE, endStyled,
+			wEditor_.LineStart(wEditor_.LineFromPosition(end) + 1));
+	EnsureRangeVisible(wEditor_, start, end);
+	wEditor_.Call(SCI_SCROLLRANGE, start, end);
+	wEditor_.Call(SCI_SETTARGETRANGE, start, end);
+	SetSelection(start, end);
+	if (!replacing && (closeFind != CloseFind::kClosePrevent)) {
+		DestroyFindReplace();
+	}
+}
+
 void CuteTextBase::HideMatch() {
 }
 
@@ -1329,6 +1470,183 @@ void CuteTextBase::OutputAppendStringSynchronised(const char *s, int len) {
 	}
 }
 
+/**
+ * Run the queued jobs from queueNext_ in order. Command line and windowed
+ * tools run on a JobRunner thread and the queue resumes from JobRunnerCompleted
+ * so the user interface stays responsive. A failing job ends the queue.
+ */
+void CuteTextBase::ExecuteNext() {
+	while (queueNext_ < jobQueue_.commandCurrent) {
+		if (jobQueue_.Cancelled()) {
+			JobQueueCompleted(false);
+			return;
+		}
+		const Job job = jobQueue_.jobQueue_[queueNext_];
+		queueNext_++;
+		if (job.command.empty())
+			continue;
+		if ((job.jobType == jobCLI) || (job.jobType == jobGUI)) {
+			if (!StartJobRunner(job))
+				JobQueueCompleted(false);
+			return;
+		}
+		int exitStatus = 0;
+		if (job.jobType == jobExtension) {
+			if (extender_)
+				extender_->OnExecute(job.command.c_str());
+		} else {
+			exitStatus = ExecuteOtherJob(job);
+		}
+		if (exitStatus != 0) {
+			JobQueueCompleted(false);
+			return;
+		}
+	}
+	JobQueueCompleted(true);
+}
+
+/**
+ * Run a shell, help or grep job. These depend on the platform so platform
+ * layers override this; the default reports the job as unsupported.
+ */
+int CuteTextBase::ExecuteOtherJob(const Job &job) {
+	std::string message(">Can not run ");
+	message += job.command;
+	message += "\n";
+	OutputAppendString(message.c_str(), static_cast<int>(message.length()));
+	return -1;
+}
+
+void CuteTextBase::JobQueueCompleted(bool success) {
+	queueRunner_ = nullptr;
+	queueNext_ = 0;
+	queueReplacement_.clear();
+	jobQueue_.ClearJobs();
+	jobQueue_.SetExecuting(false);
+	if (jobQueue_.isBuilding) {
+		jobQueue_.isBuilding = false;
+		jobQueue_.isBuilt = success;
+	}
+	// Move caret back to the start of this run's output when it was started from the output pane.
+	if ((scrollOutput_ == 1) && returnOutputToCommand_)
+		wOutput_.Send(SCI_GOTOPOS, queueOutputStart_);
+	returnOutputToCommand_ = true;
+	if (needReadProperties_) {
+		needReadProperties_ = false;
+		ReadProperties();
+	}
+	CheckMenus();
+}
+
+void CuteTextBase::StopExecute() {
+	jobQueue_.SetCancelFlag(1);
+	for (std::unique_ptr<JobRunner> &runner : jobRunners_) {
+		runner->RequestCancel();
+	}
+}
+
+/**
+ * Start a queued command line or windowed job on its own thread.
+ * Output arrives through JobRunnerOutput.
+ */
+bool CuteTextBase::StartJobRunner(const Job &job) {
+	if (!(job.flags & jobQuiet)) {
+		std::string os(">");
+		os += job.command;
+		os += "\n";
+		OutputAppendString(os.c_str(), static_cast<int>(os.length()));
+	}
+	queueReplacement_.clear();
+	jobRunners_.push_back(std::make_unique<JobRunner>(this, job));
+	if (!PerformOnNewThread(jobRunners_.back().get())) {
+		jobRunners_.pop_back();
+		OutputAppendString(">Failed to start job\n");
+		return false;
+	}
+	queueRunner_ = jobRunners_.back().get();
+	return true;
+}
+
+/**
+ * Start a tool with the background mode outside the job queue. It runs
+ * alongside the queue and any other background tools so the number running
+ * is not limited by JobQueue::commandMax. Its output is interleaved with
+ * theirs in batches and its exit line names the command.
+ */
+bool CuteTextBase::RunJobInBackground(const Job &job) {
+	if (!(job.flags & jobQuiet)) {
+		std::string os(">");
+		os += job.command;
+		os += "\n";
+		OutputAppendString(os.c_str(), static_cast<int>(os.length()));
+	}
+	jobRunners_.push_back(std::make_unique<JobRunner>(this, job));
+	if (!PerformOnNewThread(jobRunners_.back().get())) {
+		jobRunners_.pop_back();
+		OutputAppendString(">Failed to start job\n");
+		return false;
+	}
+	CheckMenus();
+	return true;
+}
+
+JobRunner *CuteTextBase::FindJobRunner(Worker *pWorker) {
+	for (std::unique_ptr<JobRunner> &runner : jobRunners_) {
+		if (runner.get() == pWorker)
+			return runner.get();
+	}
+	return nullptr;
+}
+
+void CuteTextBase::JobRunnerOutput(JobRunner *runner) {
+	// Everything gathered since the last call is appended at once.
+	const std::string output = runner->TakeOutput();
+	if (output.empty())
+		return;
+	if ((runner == queueRunner_) && (runner->job.flags & jobRepSelMask))
+		queueReplacement_ += output;
+	if (!(runner->job.flags & jobQuiet))
+		OutputAppendString(output.c_str(), static_cast<int>(output.length()));
+}
+
+void CuteTextBase::JobRunnerCompleted(JobRunner *runner) {
+	JobRunnerOutput(runner);
+	const Job job = runner->job;
+	const int exitStatus = runner->exitStatus;
+	const bool queued = runner == queueRunner_;
+	if (!(job.flags & jobQuiet) || (exitStatus != 0)) {
+		// Each runner times its own job so the time is always known.
+		std::string sExitMessage(">");
+		if (!queued) {
+			sExitMessage += job.command;
+			sExitMessage += ": ";
+		}
+		sExitMessage += "Exit code: ";
+		sExitMessage += StdStringFromInteger(exitStatus);
+		sExitMessage += "    Time: ";
+		sExitMessage += StdStringFromDouble(runner->duration, 3);
+		sExitMessage += "\n";
+		OutputAppendString(sExitMessage.c_str(), static_cast<int>(sExitMessage.length()));
+	}
+	jobRunners_.erase(std::remove_if(jobRunners_.begin(), jobRunners_.end(),
+		[runner](const std::unique_ptr<JobRunner> &candidate) { return candidate.get() == runner; }),
+		jobRunners_.end());
+	if (!queued) {
+		CheckMenus();
+		return;
+	}
+	queueRunner_ = nullptr;
+	const int repSel = job.flags & jobRepSelMask;
+	if ((repSel == jobRepSelYes) || ((repSel == jobRepSelAuto) && (exitStatus == 0))) {
+		wEditor_.CallString(SCI_REPLACESEL, 0, queueReplacement_.c_str());
+	}
+	queueReplacement_.clear();
+	if (exitStatus == 0)
+		ExecuteNext();
+	else
+		JobQueueCompleted(false);
+}
+
 void CuteTextBase::Execute() {
 	props_.Set("CurrentMessage", "");
 	dirNameForExecute_ = FilePath();
@@ -1376,6 +1694,11 @@ void CuteTextBase::Execute() {
 	}
 	CheckMenus();
 	dirNameAtExecute_ = filePath_.Directory();
+	if (jobQueue_.IsExecuting() && !queueRunner_) {
+		queueNext_ = 0;
+		queueOutputStart_ = wOutput_.Send(SCI_GETCURRENTPOS);
+		ExecuteNext();
+	}
 }
 
 void CuteTextBase::SetOutputVisibility(bool show) {
@@ -3202,11 +3525,13 @@ void CuteTextBase::MenuCommand(int cmdID, int source) {
 		break;
 
 	case IDM_FINDNEXT:
-		FindNext(reverseFind);
+		if (!FindNextInBackground(reverseFind))
+			FindNext(reverseFind);
 		break;
 
 	case IDM_FINDNEXTBACK:
-		FindNext(!reverseFind);
+		if (!FindNextInBackground(!reverseFind))
+			FindNext(!reverseFind);
 		break;
 
 	case IDM_FINDNEXTSEL:
@@ -3546,6 +3871,7 @@ void CuteTextBase::MenuCommand(int cmdID, int source) {
 		break;
 
 	case IDM_STOPEXECUTE:
+		StopFindInBackground();
 		StopExecute();
 		break;
 
@@ -3995,6 +4321,12 @@ void CuteTextBase::Notify(SCNotification *notification) {
 	case SCN_MODIFIED:
 		if (notification->nmhdr.idFrom == IDM_SRCWIN)
 			CurrentBuffer()->DocumentModified();
+		if ((notification->nmhdr.idFrom == IDM_SRCWIN) &&
+		        (notification->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))) {
+			//also when undo or redo changed the text, so stale hits and candidates are dropped
+			StopFindInBackground();
+			findMarker.ForgetMatches();
+		}
 		if (notification->modificationType & SC_LASTSTEPINUNDOREDO) {
 			//when the user hits undo or redo, several normal insert/delete
 			//notifications may fire, but we will end up here in the end
@@ -4138,8 +4470,9 @@ void CuteTextBase::CheckMenus() {
 	        props_.GetWild("command.go.", FileNameExt().AsUTF8().c_str()).size() != 0);
 	EnableAMenuItem(IDM_OPENDIRECTORYPROPERTIES, props_.GetInt("properties.directory.enable") != 0);
 	for (int toolItem = 0; toolItem < kToolMax; toolItem++)
-		EnableAMenuItem(IDM_TOOLS + toolItem, ToolIsImmediate(toolItem) || !jobQueue_.IsExecuting());
-	EnableAMenuItem(IDM_STOPEXECUTE, jobQueue_.IsExecuting());
+		EnableAMenuItem(IDM_TOOLS + toolItem,
+			ToolIsImmediate(toolItem) || ToolIsBackground(toolItem) || !jobQueue_.IsExecuting());
+	EnableAMenuItem(IDM_STOPEXECUTE, jobQueue_.IsExecuting() || !jobRunners_.empty());
 	if (buffers_.size() > 0) {
 		TabSelect(buffers_.Current());
 		for (int bufferItem = 0; bufferItem < buffers_.lengthVisible; bufferItem++) {
@@ -4682,6 +5015,21 @@ bool CuteTextBase::ProcessCommandLine(const GUI::GUIString &args, int phase) {
 				sptr_t originalEnd = 0;
 				InternalGrep(gf, FilePath::GetWorkingDirectory().AsInternal(), wlArgs[i+2].c_str(), unquoted.c_str(), originalEnd);
 				exit(0);
+			} else if (GUI::GUIString(arg) == GUI_TEXT("batch") && (wlArgs.size() - i >= 5)) {
+				// in form -batch [e~][i~][s~][d~] "<file-patterns>" "<find>" "<replace>"
+				BatchFlags bf = kBatchNone;
+				if (wlArgs[i+1][0] == 'e')
+					bf = static_cast<BatchFlags>(bf | kBatchLineEnds);
+				if (wlArgs[i+1][1] == 'i')
+					bf = static_cast<BatchFlags>(bf | kBatchIndentation);
+				if (wlArgs[i+1][2] == 's')
+					bf = static_cast<BatchFlags>(bf | kBatchStripTrailing);
+				if (wlArgs[i+1][3] == 'd')
+					bf = static_cast<BatchFlags>(bf | kBatchDot);
+				const std::string find = UnSlashString(GUI::UTF8FromString(wlArgs[i+3].c_str()).c_str());
+				const std::string replace = UnSlashString(GUI::UTF8FromString(wlArgs[i+4].c_str()).c_str());
+				InternalBatch(bf, FilePath::GetWorkingDirectory().AsInternal(), wlArgs[i+2].c_str(), find.c_str(), replace.c_str());
+				exit(0);
 			} else {
 				if (AfterName(arg) == ':') {
 					if (StartsWith(arg, GUI_TEXT("open:")) || StartsWith(arg, GUI_TEXT("loadsession:"))) {
@@ -91,6 +91,8 @@ public:
 };
 
 struct FileWorker;
+class JobRunner;
+class FindWorker;
 
 class Buffer {
 public:
@@ -521,6 +523,11 @@ protected:
     int scrollOutput_;
     bool returnOutputToCommand_;
     JobQueue jobQueue_;
+    std::vector<std::unique_ptr<JobRunner>> jobRunners_;  ///< Queued and background jobs now running
+    JobRunner *queueRunner_;        ///< Runner of the queued job now running or nullptr
+    int queueNext_;                 ///< Index in jobQueue_ of the next job to run
+    sptr_t queueOutputStart_;       ///< Output pane position when the queue started
+    std::string queueReplacement_;  ///< Output gathered to replace the selection
 
     bool macrosEnabled_;
     std::string currentMacro_;
@@ -538,6 +545,9 @@ protected:
     PropSetFile propsAbbrev_;
 
     PropSetFile propsSession_;
+    FilePath sessionSavedPath_;         ///< Session file last written
+    std::string sessionSavedContents_;  ///< Text last written to sessionSavedPath_
+    time_t sessionSavedTime_;           ///< Modification time of sessionSavedPath_ after writing
 
     FilePath pathAbbreviations_;
 
@@ -742,6 +752,7 @@ protected:
     virtual void FindMessageBox(const std::string &msg, const std::string *findItem = 0) = 0;
     bool FindReplaceAdvanced() const;
     int FindInTarget(const std::string &findWhatText, int startPosition, int endPosition);
+    void ShowFound(int start, int end);
     // Implement Searcher
     void SetFindText(const char *sFind) override;
     void SetFind(const char *sFind) override;
@@ -777,7 +788,15 @@ protected:
     void OutputAppendString(const char *s, int len = -1);
     virtual void OutputAppendStringSynchronised(const char *s, int len = -1);
     virtual void Execute();
-    virtual void StopExecute() = 0;
+    void ExecuteNext();
+    virtual int ExecuteOtherJob(const Job &job);
+    void JobQueueCompleted(bool success);
+    virtual void StopExecute();
+    bool StartJobRunner(const Job &job);
+    bool RunJobInBackground(const Job &job);
+    JobRunner *FindJobRunner(Worker *pWorker);
+    void JobRunnerOutput(JobRunner *runner);
+    void JobRunnerCompleted(JobRunner *runner);
     void ShowMessages(int line);
     void GoMessage(int dir);
     virtual bool StartCallTip();
@@ -845,6 +864,11 @@ protected:
     void RemoveFindMarks();
     int SearchFlags(bool regularExpressions) const;
     void MarkAll(MarkPurpose purpose=kMarkWithBookMarks) override;
+    bool FindInBackground(const std::string &findTarget, int flags, int startPosition, bool firstOnly, int bookMark);
+    bool FindNextInBackground(bool reverseDirection);
+    void StopFindInBackground();
+    void FindWorkerHits(FindWorker *finder);
+    void FindWorkerCompleted(FindWorker *finder);
     void BookmarkAdd(int lineno = -1);
     void BookmarkDelete(int lineno = -1);
     bool BookmarkPresent(int lineno = -1);
@@ -883,6 +907,7 @@ protected:
     void SetMenuItemLocalised(int menuNumber, int position, int itemID,
             const char *text, const char *mnemonic);
     bool ToolIsImmediate(int item);
+    bool ToolIsBackground(int item);
     void SetToolsMenu();
     JobSubsystem SubsystemType(const char *cmd);
     void ToolsMenu(int item);
@@ -953,6 +978,13 @@ protected:
     void GrepRecursive(GrepFlags gf, const FilePath &baseDir, const char *searchString, const GUI::GUIChar *fileTypes);
     void InternalGrep(GrepFlags gf, const GUI::GUIChar *directory, const GUI::GUIChar *fileTypes,
               const char *search, sptr_t &originalEnd);
+    enum BatchFlags {
+        kBatchNone = 0, kBatchLineEnds = 1, kBatchIndentation = 2, kBatchStripTrailing = 4,
+        kBatchDot = 8
+    };
+    void CollectFilesRecursive(bool includeDot, const FilePath &baseDir, const GUI::GUIChar *fileTypes, FilePathSet &found);
+    void InternalBatch(BatchFlags bf, const GUI::GUIChar *directory, const GUI::GUIChar *fileTypes,
+              const char *find, const char *replace);
     void EnumProperties(const char *propkind);
     void SendOneProperty(const char *kind, const char *key, const char *val);
     void PropertyFromDirector(const char *arg);
@@ -980,6 +1012,8 @@ protected:
     void HighlightCurrentWord(bool highlight);
     MatchMarker matchMarker_;
     MatchMarker findMarker_;
+    std::unique_ptr<FindWorker> findWorker_;  ///< Search of a large document running in the background
+    std::vector<std::unique_ptr<FindWorker>> findWorkersStopping_;  ///< Cancelled searches waiting for their completion message
 public:
 
     enum { kMaxParam = 4 };
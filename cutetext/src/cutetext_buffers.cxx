@@ -395,6 +395,8 @@ void SciTEBase::SetDocumentAt(int index, bool updateStack) {
 		return;
 	}
 	UpdateBuffersCurrent();
+	StopFindInBackground();
+	findMarker.ForgetMatches();
 
 	buffers.SetCurrent(index);
 	if (updateStack) {
@@ -606,6 +608,8 @@ std::vector<int> LinesFromString(const std::string &s) {
 
 std::string StringFromLines(const std::vector<int> &lines) {
 	std::string result;
+	// Most line numbers fit in 7 digits plus a separator
+	result.reserve(lines.size() * 8);
 	for (const int line : lines) {
 		if (result.length()) {
 			result.append(",");
@@ -692,6 +696,17 @@ void SciTEBase::RestoreSession() {
 	RestoreFromSession(session);
 }
 
+namespace {
+
+void AppendSessionProperty(std::string &session, const std::string &key, const std::string &value) {
+	session.append(key);
+	session.append("=");
+	session.append(value);
+	session.append("\n");
+}
+
+}
+
 void SciTEBase::SaveSessionFile(const GUI::GUIChar *sessionName) {
 	UpdateBuffersCurrent();
 	bool defaultSession;
@@ -703,106 +718,111 @@ void SciTEBase::SaveSessionFile(const GUI::GUIChar *sessionName) {
 		sessionPathName.Set(sessionName);
 		defaultSession = false;
 	}
-	FILE *sessionFile = sessionPathName.Open(fileWrite);
-	if (!sessionFile)
-		return;
 
-	fprintf(sessionFile, "# SciTE session file\n");
+	// Build the whole session in memory so it can be written with a single call
+	// and skipped when nothing has changed since it was last saved.
+	std::string session = "# SciTE session file\n";
 
 	if (defaultSession && props_.GetInt("save.position")) {
 		int top, left, width, height, maximize;
 		GetWindowPosition(&left, &top, &width, &height, &maximize);
 
-		fprintf(sessionFile, "\n");
-		fprintf(sessionFile, "position.left=%d\n", left);
-		fprintf(sessionFile, "position.top=%d\n", top);
-		fprintf(sessionFile, "position.width=%d\n", width);
-		fprintf(sessionFile, "position.height=%d\n", height);
-		fprintf(sessionFile, "position.maximize=%d\n", maximize);
+		session.append("\n");
+		AppendSessionProperty(session, "position.left", StdStringFromInteger(left));
+		AppendSessionProperty(session, "position.top", StdStringFromInteger(top));
+		AppendSessionProperty(session, "position.width", StdStringFromInteger(width));
+		AppendSessionProperty(session, "position.height", StdStringFromInteger(height));
+		AppendSessionProperty(session, "position.maximize", StdStringFromInteger(maximize));
 	}
 
 	if (defaultSession && props_.GetInt("save.recent")) {
-		std::string propKey;
 		int j = 0;
 
-		fprintf(sessionFile, "\n");
+		session.append("\n");
 
 		// Save recent files list
 		for (int i = kFileStackMax - 1; i >= 0; i--) {
 			if (recentFileStack_[i].IsSet()) {
-				propKey = IndexPropKey("mru", j++, "path");
-				fprintf(sessionFile, "%s=%s\n", propKey.c_str(), recentFileStack_[i].AsUTF8().c_str());
+				AppendSessionProperty(session, IndexPropKey("mru", j++, "path"), recentFileStack_[i].AsUTF8());
 			}
 		}
 	}
 
 	if (defaultSession && props_.GetInt("save.find")) {
-		std::string propKey;
-		std::vector<std::string>::iterator it;
 		std::vector<std::string> mem = memFinds.AsVector();
 		if (!mem.empty()) {
-			fprintf(sessionFile, "\n");
-			it = mem.begin();
-			for (int i = 0; it != mem.end(); i++, ++it) {
-				propKey = IndexPropKey("search", i, "findwhat");
-				fprintf(sessionFile, "%s=%s\n", propKey.c_str(), (*it).c_str());
+			session.append("\n");
+			for (size_t i = 0; i < mem.size(); i++) {
+				AppendSessionProperty(session, IndexPropKey("search", static_cast<int>(i), "findwhat"), mem[i]);
 			}
 		}
 
 		mem = memReplaces.AsVector();
 		if (!mem.empty()) {
-			fprintf(sessionFile, "\n");
-			mem = memReplaces.AsVector();
-			it = mem.begin();
-			for (int i = 0; it != mem.end(); i++, ++it) {
-				propKey = IndexPropKey("search", i, "replacewith");
-				fprintf(sessionFile, "%s=%s\n", propKey.c_str(), (*it).c_str());
+			session.append("\n");
+			for (size_t i = 0; i < mem.size(); i++) {
+				AppendSessionProperty(session, IndexPropKey("search", static_cast<int>(i), "replacewith"), mem[i]);
 			}
 		}
 	}
 
 	if (props_.GetInt("buffers") && (!defaultSession || props_.GetInt("save.session"))) {
 		const int curr = buffers.Current();
+		const bool saveBookmarks = props_.GetInt("session.bookmarks") != 0;
+		const bool saveFolds = props_.GetInt("fold") && props_.GetInt("session.folds");
 		for (int i = 0; i < buffers.lengthVisible; i++) {
 			const Buffer &buff = buffers.buffers[i];
 			if (buff.file.IsSet() && !buff.file.IsUntitled()) {
-				std::string propKey = IndexPropKey("buffer", i, "path");
-				fprintf(sessionFile, "\n%s=%s\n", propKey.c_str(), buff.file.AsUTF8().c_str());
+				session.append("\n");
+				AppendSessionProperty(session, IndexPropKey("buffer", i, "path"), buff.file.AsUTF8());
 
 				const int pos = buff.file.selection.position + 1;
-				propKey = IndexPropKey("buffer", i, "position");
-				fprintf(sessionFile, "%s=%d\n", propKey.c_str(), pos);
+				AppendSessionProperty(session, IndexPropKey("buffer", i, "position"), StdStringFromInteger(pos));
 
 				const int scroll = buff.file.scrollPosition;
-				propKey = IndexPropKey("buffer", i, "scroll");
-				fprintf(sessionFile, "%s=%d\n", propKey.c_str(), scroll);
+				AppendSessionProperty(session, IndexPropKey("buffer", i, "scroll"), StdStringFromInteger(scroll));
 
 				if (i == curr) {
-					propKey = IndexPropKey("buffer", i, "current");
-					fprintf(sessionFile, "%s=1\n", propKey.c_str());
+					AppendSessionProperty(session, IndexPropKey("buffer", i, "current"), "1");
 				}
 
-				if (props_.GetInt("session.bookmarks")) {
+				if (saveBookmarks) {
 					const std::string bmString = StringFromLines(buff.bookmarks);
 					if (bmString.length()) {
-						propKey = IndexPropKey("buffer", i, "bookmarks");
-						fprintf(sessionFile, "%s=%s\n", propKey.c_str(), bmString.c_str());
+						AppendSessionProperty(session, IndexPropKey("buffer", i, "bookmarks"), bmString);
 					}
 				}
 
-				if (props_.GetInt("fold") && props_.GetInt("session.folds")) {
+				if (saveFolds) {
 					const std::string foldsString = StringFromLines(buff.foldState);
 					if (foldsString.length()) {
-						propKey = IndexPropKey("buffer", i, "folds");
-						fprintf(sessionFile, "%s=%s\n", propKey.c_str(), foldsString.c_str());
+						AppendSessionProperty(session, IndexPropKey("buffer", i, "folds"), foldsString);
 					}
 				}
 			}
 		}
 	}
 
-	if (fclose(sessionFile) != 0) {
-		FailedSaveMessageBox(sessionPathName);
+	// The file may have been rewritten or truncated by another instance or the user
+	// since it was saved, so its size and time must also be as written.
+	const bool unchanged = (sessionSavedPath_ == sessionPathName) &&
+		(sessionSavedContents_ == session) && sessionPathName.Exists() &&
+		(sessionPathName.GetFileLength() == static_cast<long long>(session.length())) &&
+		(sessionPathName.ModifiedTime() == sessionSavedTime_);
+	if (!unchanged) {
+		FILE *sessionFile = sessionPathName.Open(fileWrite);
+		if (!sessionFile)
+			return;
+		const size_t written = fwrite(session.c_str(), 1, session.length(), sessionFile);
+		if ((fclose(sessionFile) != 0) || (written != session.length())) {
+			sessionSavedPath_.Init();
+			sessionSavedContents_.clear();
+			FailedSaveMessageBox(sessionPathName);
+		} else {
+			sessionSavedPath_ = sessionPathName;
+			sessionSavedContents_ = session;
+			sessionSavedTime_ = sessionPathName.ModifiedTime();
+		}
 	}
 
 	FilePath sessionFilePath = FilePath(sessionPathName).AbsolutePath();
@@ -1425,6 +1445,16 @@ bool SciTEBase::ToolIsImmediate(int item) {
 	return false;
 }
 
+bool SciTEBase::ToolIsBackground(int item) {
+	const std::string propName = "command." + StdStringFromInteger(item) + ".";
+	std::string command = props_.GetWild(propName.c_str(), FileNameExt().AsUTF8().c_str());
+	if (command.length()) {
+		JobMode jobMode(props_, item, FileNameExt().AsUTF8().c_str());
+		return (jobMode.flags & jobBackground) != 0;
+	}
+	return false;
+}
+
 void SciTEBase::SetToolsMenu() {
 	//command.name.0.*.py=Edit in PythonWin
 	//command.0.*.py="c:\program files\python\pythonwin\pythonwin" /edit c:\coloreditor.py
@@ -1484,7 +1514,8 @@ void SciTEBase::ToolsMenu(int item) {
 	std::string command(props_.GetWild(propName.c_str(), FileNameExt().AsUTF8().c_str()).c_str());
 	if (command.length()) {
 		JobMode jobMode(props_, item, FileNameExt().AsUTF8().c_str());
-		if (jobQueue_.IsExecuting() && (jobMode.jobType != jobImmediate))
+		const bool independent = (jobMode.jobType == jobImmediate) || (jobMode.flags & jobBackground);
+		if (jobQueue_.IsExecuting() && !independent)
 			// Busy running a tool and running a second can cause failures.
 			return;
 		if (jobMode.saveBefore == 2 || (jobMode.saveBefore == 1 && (!(CurrentBuffer()->isDirty_) || Save())) || SaveIfUnsure() != kSaveCancelled) {
@@ -1494,6 +1525,8 @@ void SciTEBase::ToolsMenu(int item) {
 				if (extender_) {
 					extender_->OnExecute(command.c_str());
 				}
+			} else if (jobMode.flags & jobBackground) {
+				RunJobInBackground(Job(command, filePath_.Directory(), jobMode.jobType, jobMode.input, jobMode.flags));
 			} else {
 				AddCommand(command.c_str(), "", jobMode.jobType, jobMode.input, jobMode.flags);
 				if (jobQueue_.HasCommandToRun())
@@ -26,6 +26,8 @@
 #include <set>
 #include <algorithm>
 #include <memory>
+#include <atomic>
+#include <thread>
 
 #include <fcntl.h>
 
@@ -51,6 +53,7 @@
 #include "MatchMarker.h"
 #include "SciTEBase.h"
 #include "Utf8_16.h"
+#include "batch_transform.h"
 
 #if defined(GTK)
 const GUI::GUIChar propUserFileName[] = GUI_TEXT(".SciTEUser.properties");
@@ -1558,3 +1561,114 @@ void SciTEBase::InternalGrep(GrepFlags gf, const GUI::GUIChar *directory, const
 	}
 }
 
+void SciTEBase::CollectFilesRecursive(bool includeDot, const FilePath &baseDir, const GUI::GUIChar *fileTypes, FilePathSet &found) {
+	FilePathSet directories;
+	FilePathSet files;
+	baseDir.List(directories, files);
+	for (const FilePath &fPath : files) {
+		if (*fileTypes == '\0' || fPath.Matches(fileTypes)) {
+			found.push_back(fPath);
+		}
+	}
+	for (const FilePath &fPath : directories) {
+		if (includeDot || GrepIntoDirectory(fPath.Name())) {
+			CollectFilesRecursive(includeDot, fPath, fileTypes, found);
+		}
+	}
+}
+
+/**
+ * Transform every matching file below a directory without using the editor.
+ * Settings are resolved from properties once per extension on this thread then
+ * the files are shared out between worker threads as each finishes its last file.
+ */
+void SciTEBase::InternalBatch(BatchFlags bf, const GUI::GUIChar *directory, const GUI::GUIChar *fileTypes,
+	const char *find, const char *replace) {
+	GUI::ElapsedTime commandTime;
+	FilePathSet files;
+	CollectFilesRecursive((bf & kBatchDot) != 0, FilePath(directory), fileTypes, files);
+
+	int eolMode = SC_EOL_LF;
+	const std::string eolModeProp = props_.GetString("eol.mode");
+	if (eolModeProp == "CR") {
+		eolMode = SC_EOL_CR;
+	} else if (eolModeProp == "CRLF") {
+		eolMode = SC_EOL_CRLF;
+	}
+
+	std::map<std::string, BatchOptions> optionsForExtension;
+	std::vector<const BatchOptions *> optionsForFile;
+	std::vector<BatchFileResult> results(files.size());
+	for (size_t i = 0; i < files.size(); i++) {
+		results[i].path = files[i];
+		// Matches the form ExtensionFileName uses for property lookup.
+		std::string fileNameForExtension = files[i].Name().AsUTF8();
+		std::string extension = files[i].Extension().AsUTF8();
+		if (!extension.empty()) {
+			LowerCaseAZ(extension);
+			fileNameForExtension = "x." + extension;
+		}
+		std::map<std::string, BatchOptions>::iterator it = optionsForExtension.find(fileNameForExtension);
+		if (it == optionsForExtension.end()) {
+			BatchOptions options;
+			options.convertLineEnds = (bf & kBatchLineEnds) != 0;
+			options.eolMode = eolMode;
+			options.convertIndentation = (bf & kBatchIndentation) != 0;
+			const std::string useTabs = props_.GetNewExpandString("use.tabs.", fileNameForExtension.c_str());
+			options.useTabs = useTabs.length() ? (atoi(useTabs.c_str()) != 0) : (props_.GetInt("use.tabs", 1) != 0);
+			const std::string tabSize = props_.GetNewExpandString("tab.size.", fileNameForExtension.c_str());
+			options.tabSize = tabSize.length() ? atoi(tabSize.c_str()) : props_.GetInt("tabsize", 8);
+			options.stripTrailingSpaces = (bf & kBatchStripTrailing) != 0;
+			options.find = find;
+			options.replace = replace;
+			it = optionsForExtension.insert(std::make_pair(fileNameForExtension, options)).first;
+		}
+		optionsForFile.push_back(&it->second);
+	}
+
+	std::atomic<size_t> nextFile(0);
+	auto processFiles = [&]() {
+		for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+			BatchTransformFile(*optionsForFile[i], results[i]);
+		}
+	};
+	const size_t threadCount = std::min<size_t>(files.size(), std::max(1U, std::thread::hardware_concurrency()));
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threadCount; t++) {
+		workers.emplace_back(processFiles);
+	}
+	processFiles();
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	size_t changed = 0;
+	size_t failed = 0;
+	std::string os;
+	for (const BatchFileResult &result : results) {
+		os.append(result.path.AsUTF8());
+		if (result.failed) {
+			os.append(": failed");
+			failed++;
+		} else if (result.changed) {
+			os.append(": changed");
+			changed++;
+		} else {
+			os.append(": unchanged");
+		}
+		os.append("    Time: ");
+		os.append(StdStringFromDouble(result.duration, 3));
+		os.append("\n");
+	}
+	os.append(">Batch processed ");
+	os.append(StdStringFromSizeT(results.size()));
+	os.append(" files, ");
+	os.append(StdStringFromSizeT(changed));
+	os.append(" changed, ");
+	os.append(StdStringFromSizeT(failed));
+	os.append(" failed    Time: ");
+	os.append(StdStringFromDouble(commandTime.Duration(), 3));
+	os.append("\n");
+	fwrite(os.c_str(), os.length(), 1, stdout);
+}
+
@@ -68,5 +68,9 @@ enum {
 	kWorkFileRead = 1,
 	kWorkFileWritten = 2,
 	kWorkFileProgress = 3,
+	kWorkJobOutput = 4,
+	kWorkJobCompleted = 5,
+	kWorkFindHits = 6,
+	kWorkFindCompleted = 7,
 	kWorkPlatform = 100
 };
@@ -0,0 +1,347 @@
+// This file is part of CuteText project
+// Copyright (C) 2026 by the CuteText contributors
+// The LICENSE file describes the conditions under which this software may be distributed.
+/**
+ * @file find_worker.cxx
+ * @date 2026-10-18
+ * @brief Implementation of class to search a snapshot of a document as a background task.
+ *
+ * @see https://github.com/cutetext/cutetext
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "ILoader.h"
+#include "Scintilla.h"
+
+#include "UniConversion.h"
+#include "CaseConvert.h"
+#include "CharacterCategory.h"
+
+#include "gui.h"
+#include "filepath.h"
+#include "mutex.h"
+#include "cookie.h"
+#include "worker.h"
+#include "fileworker.h"
+#include "find_worker.h"
+
+using namespace Scintilla;
+
+namespace {
+
+/// Text is searched in blocks of this size between checks for cancellation.
+const size_t searchBlockSize = 8 * blockSize;
+
+/// The classes of Scintilla's CharClassify.
+enum { kClassSpace, kClassNewLine, kClassWord, kClassPunctuation };
+
+unsigned char MakeLowerASCII(unsigned char ch) {
+	return ((ch >= 'A') && (ch <= 'Z')) ? static_cast<unsigned char>(ch - 'A' + 'a') : ch;
+}
+
+void LowerCaseASCII(std::string &s) {
+	for (char &ch : s) {
+		ch = MakeLowerASCII(ch);
+	}
+}
+
+bool IsASCII(std::string_view s) {
+	for (const char ch : s) {
+		if (!UTF8IsAscii(static_cast<unsigned char>(ch)))
+			return false;
+	}
+	return true;
+}
+
+bool IsValidUTF8(std::string_view s) {
+	size_t position = 0;
+	while (position < s.length()) {
+		const int status = UTF8Classify(reinterpret_cast<const unsigned char *>(s.data() + position),
+			s.length() - position);
+		if (status & UTF8MaskInvalid)
+			return false;
+		position += status & UTF8MaskWidth;
+	}
+	return true;
+}
+
+/// Width of the character at the start of bytes with invalid bytes counting as 1.
+int WidthUTF8(const unsigned char *bytes, size_t length) {
+	if (UTF8IsAscii(bytes[0]))
+		return 1;
+	const int status = UTF8Classify(bytes, length);
+	return (status & UTF8MaskInvalid) ? 1 : (status & UTF8MaskWidth);
+}
+
+}
+
+FindWorker::FindWorker(WorkerListener *pListener_, ITextSnapshot *snapshot_, const std::string &findWhat_,
+	int flags_, int codePage_, const std::string &wordCharacters_, const std::string &whitespaceCharacters_,
+	int startPosition_, bool wrap_, bool firstOnly_, int bookMark_) :
+	hitsMutex(Mutex::Create()), hitsPosted(false), snapshot(snapshot_), lengthText(snapshot_->Length()),
+	findWhat(findWhat_), flags(flags_), codePage(codePage_), pListener(pListener_), startPosition(startPosition_),
+	wrap(wrap_), firstOnly(firstOnly_), bookMark(bookMark_), found(0) {
+	if (!(flags & SCFIND_MATCHCASE)) {
+		LowerCaseASCII(findWhat);
+		// Folding here also fills Scintilla's case tables on this thread before the worker reads them.
+		if (codePage == SC_CP_UTF8)
+			findWhat = CaseConvertString(findWhat, CaseConversionFold);
+	}
+	std::fill(std::begin(characterClasses), std::end(characterClasses), static_cast<unsigned char>(kClassPunctuation));
+	characterClasses[static_cast<unsigned char>('\r')] = kClassNewLine;
+	characterClasses[static_cast<unsigned char>('\n')] = kClassNewLine;
+	for (const char ch : whitespaceCharacters_) {
+		characterClasses[static_cast<unsigned char>(ch)] = kClassSpace;
+	}
+	for (const char ch : wordCharacters_) {
+		characterClasses[static_cast<unsigned char>(ch)] = kClassWord;
+	}
+	SetSizeJob(lengthText);
+}
+
+FindWorker::~FindWorker() {
+	snapshot->Release();
+}
+
+/**
+ * Only plain text is searched in the background. Regular expressions need the
+ * document's own search engine. Case insensitive search in a single byte document
+ * is limited to ASCII as other characters fold according to the platform's code page.
+ */
+bool FindWorker::CanSearch(const std::string &findWhat, int flags, int codePage) {
+	if (findWhat.empty() || (flags & SCFIND_REGEXP))
+		return false;
+	if (codePage == SC_CP_UTF8)
+		return IsValidUTF8(findWhat);
+	return (flags & SCFIND_MATCHCASE) || IsASCII(findWhat);
+}
+
+void FindWorker::GetSpan(size_t start, size_t end, std::string &span) const {
+	span.resize(end - start);
+	if (end > start)
+		snapshot->GetCharRange(&span[0], start, end - start);
+}
+
+// Mirrors Document::WordCharacterClass.
+int FindWorker::ClassOfCharacter(int character) const {
+	if ((codePage != SC_CP_UTF8) || UTF8IsAscii(character))
+		return characterClasses[static_cast<unsigned char>(character)];
+	switch (CategoriseCharacter(character)) {
+	case ccZl:
+	case ccZp:
+		return kClassNewLine;
+	case ccZs:
+	case ccCc:
+	case ccCf:
+	case ccCs:
+	case ccCo:
+	case ccCn:
+		return kClassSpace;
+	case ccLu:
+	case ccLl:
+	case ccLt:
+	case ccLm:
+	case ccLo:
+	case ccNd:
+	case ccNl:
+	case ccNo:
+	case ccMn:
+	case ccMc:
+	case ccMe:
+		return kClassWord;
+	default:
+		return kClassPunctuation;
+	}
+}
+
+int FindWorker::ClassAfter(size_t position) const {
+	unsigned char bytes[UTF8MaxBytes] = {};
+	const size_t length = std::min<size_t>(UTF8MaxBytes, lengthText - position);
+	snapshot->GetCharRange(reinterpret_cast<char *>(bytes), position, length);
+	if ((codePage != SC_CP_UTF8) || UTF8IsAscii(bytes[0]))
+		return characterClasses[bytes[0]];
+	const int status = UTF8Classify(bytes, length);
+	return ClassOfCharacter((status & UTF8MaskInvalid) ? unicodeReplacementChar : UnicodeFromUTF8(bytes));
+}
+
+int FindWorker::ClassBefore(size_t position) const {
+	unsigned char bytes[UTF8MaxBytes] = {};
+	const size_t length = std::min<size_t>(UTF8MaxBytes, position);
+	snapshot->GetCharRange(reinterpret_cast<char *>(bytes), position - length, length);
+	const unsigned char previous = bytes[length - 1];
+	if ((codePage != SC_CP_UTF8) || UTF8IsAscii(previous))
+		return characterClasses[previous];
+	// Find the lead byte of a valid character ending at position.
+	size_t lead = length - 1;
+	while ((lead > 0) && UTF8IsTrailByte(bytes[lead]))
+		lead--;
+	const int status = UTF8Classify(bytes + lead, length - lead);
+	if (!(status & UTF8MaskInvalid) && (static_cast<size_t>(status & UTF8MaskWidth) == length - lead))
+		return ClassOfCharacter(UnicodeFromUTF8(bytes + lead));
+	return ClassOfCharacter(unicodeReplacementChar);
+}
+
+// Mirrors Document::MatchesWordOptions.
+bool FindWorker::WordMatch(size_t start, size_t end) const {
+	const bool word = (flags & SCFIND_WHOLEWORD) != 0;
+	const bool wordStart = (flags & SCFIND_WORDSTART) != 0;
+	if (!word && !wordStart)
+		return true;
+	auto IsWordOrPunctuation = [](int characterClass) {
+		return (characterClass == kClassWord) || (characterClass == kClassPunctuation);
+	};
+	auto IsWordStartAt = [&](size_t position) {
+		if (position >= lengthText)
+			return false;
+		if (position == 0)
+			return true;
+		const int classAfter = ClassAfter(position);
+		return IsWordOrPunctuation(classAfter) && (classAfter != ClassBefore(position));
+	};
+	auto IsWordEndAt = [&](size_t position) {
+		if (position == 0)
+			return false;
+		if (position >= lengthText)
+			return true;
+		const int classBefore = ClassBefore(position);
+		return IsWordOrPunctuation(classBefore) && (classBefore != ClassAfter(position));
+	};
+	return (word && (start < end) && IsWordStartAt(start) && IsWordEndAt(end)) ||
+		(wordStart && IsWordStartAt(start));
+}
+
+/**
+ * Compare the case folded characters of span from offset with the folded find text as
+ * Scintilla does for UTF-8. Returns the length of the match in span or 0 if it does not match.
+ */
+size_t FindWorker::MatchFolded(const std::string &span, size_t offset) const {
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(span.data());
+	size_t position = offset;
+	size_t indexFind = 0;
+	while (indexFind < findWhat.length()) {
+		if (position >= span.length())
+			return 0;
+		const int width = WidthUTF8(bytes + position, span.length() - position);
+		const char *folded = span.data() + position;
+		size_t lengthFolded = width;
+		char lowered = 0;
+		if (UTF8IsAscii(bytes[position])) {
+			lowered = MakeLowerASCII(bytes[position]);
+			folded = &lowered;
+		} else if (width > 1) {
+			const char *conversion = CaseConvert(UnicodeFromUTF8(bytes + position), CaseConversionFold);
+			if (conversion) {
+				folded = conversion;
+				lengthFolded = strlen(conversion);
+			}
+		}
+		if (findWhat.compare(indexFind, lengthFolded, folded, lengthFolded) != 0)
+			return 0;
+		indexFind += lengthFolded;
+		position += width;
+	}
+	return position - offset;
+}
+
+void FindWorker::AddHit(size_t start, size_t end) {
+	bool post = false;
+	{
+		Lock lock(hitsMutex.get());
+		hits.emplace_back(static_cast<int>(start), static_cast<int>(end));
+		found++;
+		if (!hitsPosted) {
+			hitsPosted = true;
+			post = true;
+		}
+	}
+	// Only the first hit of a batch wakes the main thread.
+	if (post)
+		pListener->PostOnMainThread(kWorkFindHits, this);
+}
+
+std::vector<FindHit> FindWorker::TakeHits() {
+	Lock lock(hitsMutex.get());
+	std::vector<FindHit> taken;
+	taken.swap(hits);
+	hitsPosted = false;
+	return taken;
+}
+
+/**
+ * Find matches that start in [startSearch, endSearch). Returns true when the search
+ * should stop because only the first match was wanted or the search was cancelled.
+ */
+bool FindWorker::Search(size_t startSearch, size_t endSearch) {
+	const size_t lenFind = findWhat.length();
+	const bool caseSensitive = (flags & SCFIND_MATCHCASE) != 0;
+	// Each byte of folded find text may come from a character of up to UTF8MaxBytes.
+	const size_t lenMatchMaximum = caseSensitive ? lenFind : lenFind * UTF8MaxBytes;
+	std::string span;
+	size_t nextMatch = startSearch;	// Matches do not overlap
+	for (size_t startBlock = startSearch; startBlock < endSearch; startBlock += searchBlockSize) {
+		if (Cancelling())
+			return true;
+		const size_t endBlock = std::min(startBlock + searchBlockSize, endSearch);
+		const size_t lengthBlock = endBlock - startBlock;
+		// Matches start in the block but may run on past its end.
+		GetSpan(startBlock, std::min(endBlock + lenMatchMaximum, lengthText), span);
+		size_t offset = nextMatch - startBlock;
+		if (caseSensitive || (codePage != SC_CP_UTF8) || IsASCII(span)) {
+			// Folding bytes one for one keeps positions so a plain search works.
+			if (!caseSensitive)
+				LowerCaseASCII(span);
+			offset = span.find(findWhat, offset);
+			while (offset < lengthBlock) {
+				const size_t position = startBlock + offset;
+				if (WordMatch(position, position + lenFind)) {
+					AddHit(position, position + lenFind);
+					if (firstOnly)
+						return true;
+					nextMatch = position + lenFind;
+					offset += lenFind;
+				} else {
+					offset++;
+				}
+				offset = span.find(findWhat, offset);
+			}
+		} else {
+			// Characters may fold to a different number of bytes, so compare one character at a time.
+			while (offset < lengthBlock) {
+				const size_t lengthMatch = MatchFolded(span, offset);
+				const size_t position = startBlock + offset;
+				if (lengthMatch && WordMatch(position, position + lengthMatch)) {
+					AddHit(position, position + lengthMatch);
+					if (firstOnly)
+						return true;
+					offset += lengthMatch;
+				} else {
+					offset += WidthUTF8(reinterpret_cast<const unsigned char *>(span.data()) + offset,
+						span.length() - offset);
+				}
+			}
+			nextMatch = startBlock + offset;
+		}
+		nextMatch = std::max(nextMatch, endBlock);
+		IncrementProgress(lengthBlock);
+	}
+	return false;
+}
+
+void FindWorker::Execute() {
+	const size_t start = std::min(static_cast<size_t>(startPosition), lengthText);
+	if (!Search(start, lengthText) && wrap) {
+		Search(0, start);
+	}
+	SetCompleted();
+	pListener->PostOnMainThread(kWorkFindCompleted, this);
+}
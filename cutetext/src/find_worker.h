@@ -0,0 +1,66 @@
+// This file is part of CuteText project
+// Copyright (C) 2026 by the CuteText contributors
+// The LICENSE file describes the conditions under which this software may be distributed.
+/**
+ * @file find_worker.h
+ * @date 2026-10-18
+ * @brief Definition of class to search a snapshot of a document as a background task.
+ *
+ * @see https://github.com/cutetext/cutetext
+ */
+
+#ifndef FINDWORKER_H
+#define FINDWORKER_H
+
+struct FindHit {
+	int start;
+	int end;
+	FindHit(int start_, int end_) : start(start_), end(end_) {}
+};
+
+/**
+ * Searches a snapshot of a document for literal text on a worker thread so
+ * that finding in very large files does not freeze the editor and can be cancelled.
+ * Case folding and word boundaries follow Scintilla's own search for the same code page.
+ * Matches are gathered into a batch which the main thread takes whole, so marking
+ * many matches costs one wake up per batch rather than one per match.
+ * The search starts at startPosition and wraps around to it when wrap is set.
+ */
+class FindWorker : public Worker {
+	std::unique_ptr<Mutex> hitsMutex;
+	std::vector<FindHit> hits;
+	bool hitsPosted;	///< A kWorkFindHits has been posted and not yet taken
+	ITextSnapshot *snapshot;
+	size_t lengthText;
+	std::string findWhat;	///< Case folded when the search is case insensitive
+	int flags;
+	int codePage;
+	unsigned char characterClasses[256];
+	void GetSpan(size_t start, size_t end, std::string &span) const;
+	int ClassOfCharacter(int character) const;
+	int ClassAfter(size_t position) const;
+	int ClassBefore(size_t position) const;
+	bool WordMatch(size_t start, size_t end) const;
+	size_t MatchFolded(const std::string &span, size_t offset) const;
+	void AddHit(size_t start, size_t end);
+	bool Search(size_t startSearch, size_t endSearch);
+public:
+	WorkerListener *pListener;
+	int startPosition;
+	bool wrap;
+	bool firstOnly;	///< Stop at the first match
+	int bookMark;	///< Marker to add on lines with matches or -1
+	int found;	///< Number of matches found so far
+
+	/// Takes ownership of snapshot_. wordCharacters_ and whitespaceCharacters_ are the
+	/// editor's character classes as returned by SCI_GETWORDCHARS and SCI_GETWHITESPACECHARS.
+	FindWorker(WorkerListener *pListener_, ITextSnapshot *snapshot_, const std::string &findWhat_,
+		int flags_, int codePage_, const std::string &wordCharacters_, const std::string &whitespaceCharacters_,
+		int startPosition_, bool wrap_, bool firstOnly_, int bookMark_);
+	~FindWorker() override;
+	void Execute() override;
+	std::vector<FindHit> TakeHits();
+	static bool CanSearch(const std::string &findWhat, int flags, int codePage);
+};
+
+#endif
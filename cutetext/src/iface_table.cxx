@@ -2903,6 +2903,7 @@ static IFaceFunction ifaceFunctions[] = {
 	{"CountCharacters", 2633, iface_int, {iface_position, iface_position}},
 	{"CreateDocument", 2375, iface_int, {iface_int, iface_int}},
 	{"CreateLoader", 2632, iface_int, {iface_int, iface_int}},
+	{"CreateTextSnapshot", 2710, iface_int, {iface_void, iface_void}},
 	{"Cut", 2177, iface_void, {iface_void, iface_void}},
 	{"DelLineLeft", 2395, iface_void, {iface_void, iface_void}},
 	{"DelLineRight", 2396, iface_void, {iface_void, iface_void}},
@@ -3374,7 +3375,7 @@ static IFaceProperty ifaceProperties[] = {
 };
 
 enum {
-	ifaceFunctionCount = 301,
+	ifaceFunctionCount = 302,
 	ifaceConstantCount = 2706,
 	ifacePropertyCount = 229
 };
@@ -58,6 +58,7 @@ JobMode::JobMode(PropSetFile &props, int item, const char *fileNameExt) : jobTyp
 	bool quiet = false;
 	int repSel = 0;
 	bool groupUndo = false;
+	bool background = false;
 
 	const std::string itemSuffix = StdStringFromInteger(item) + ".";
 	std::string propName = std::string("command.mode.") + itemSuffix;
@@ -131,6 +132,13 @@ JobMode::JobMode(PropSetFile &props, int item, const char *fileNameExt) : jobTyp
 			else if (value[0] == '0' || value == "no")
 				groupUndo = false;
 		}
+
+		if (opt == "background") {
+			if (value.empty() || value[0] == '1' || value == "yes")
+				background = true;
+			else if (value[0] == '0' || value == "no")
+				background = false;
+		}
 	}
 
 	// The mode flags also have classic properties with similar effect.
@@ -182,6 +190,10 @@ JobMode::JobMode(PropSetFile &props, int item, const char *fileNameExt) : jobTyp
 
 	if (groupUndo)
 		flags |= jobGroupUndo;
+
+	// Only tools run on a JobRunner can run alongside the queue.
+	if (background && ((jobType == jobCLI) || (jobType == jobGUI)))
+		flags |= jobBackground;
 }
 
 Job::Job() : jobType(jobCLI), flags(0) {
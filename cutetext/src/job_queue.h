@@ -28,7 +28,8 @@ enum JobFlags {
     jobRepSelMask = 48,
     jobRepSelYes = 16,
     jobRepSelAuto = 32,
-    jobGroupUndo = 64
+    jobGroupUndo = 64,
+    jobBackground = 128
 };
 
 struct JobMode {
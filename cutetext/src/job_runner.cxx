@@ -0,0 +1,388 @@
+// This file is part of CuteText project
+// Copyright (C) 2026 by the CuteText contributors
+// The LICENSE file describes the conditions under which this software may be distributed.
+/**
+ * @file job_runner.cxx
+ * @date 2026-10-18
+ * @brief Implementation of class to run a command line job as a background task.
+ *
+ * @see https://github.com/cutetext/cutetext
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <memory>
+
+#if defined(_WIN32)
+
+#include <atomic>
+#include <thread>
+
+#include <windows.h>
+
+#elif defined(__unix__)
+
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#endif
+
+#include "ILoader.h"
+#include "Scintilla.h"
+
+#include "gui.h"
+#include "string_helpers.h"
+#include "filepath.h"
+#include "propset_file.h"
+#include "mutex.h"
+#include "job_queue.h"
+#include "cookie.h"
+#include "worker.h"
+#include "fileworker.h"
+#include "job_runner.h"
+
+namespace {
+
+#if defined(_WIN32)
+
+/// How often, in milliseconds, the output loop wakes to check for cancellation.
+const DWORD pollInterval = 100;
+
+void CloseHandleOnce(HANDLE &handle) {
+	if (handle) {
+		::CloseHandle(handle);
+		handle = NULL;
+	}
+}
+
+#elif defined(__unix__)
+
+/// How often, in milliseconds, the output loop wakes to check for cancellation.
+const int pollInterval = 100;
+
+void CloseDescriptor(int &fd) {
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+#endif
+
+}
+
+JobRunner::JobRunner(WorkerListener *pListener_, const Job &job_) :
+	outputMutex(Mutex::Create()), outputPosted(false), pListener(pListener_), job(job_), exitStatus(0), duration(0.0) {
+}
+
+JobRunner::~JobRunner() {
+}
+
+void JobRunner::AppendOutput(const char *s, size_t len) {
+	bool post = false;
+	{
+		Lock lock(outputMutex.get());
+		output.append(s, len);
+		if (!outputPosted) {
+			outputPosted = true;
+			post = true;
+		}
+	}
+	// Only the first block of a batch wakes the main thread; later blocks are
+	// picked up by the same TakeOutput call.
+	if (post)
+		pListener->PostOnMainThread(kWorkJobOutput, this);
+}
+
+std::string JobRunner::TakeOutput() {
+	Lock lock(outputMutex.get());
+	std::string taken;
+	taken.swap(output);
+	outputPosted = false;
+	return taken;
+}
+
+void JobRunner::Execute() {
+	GUI::ElapsedTime commandTime;
+#if defined(_WIN32)
+	// The child's standard handles are inherited ends of anonymous pipes while
+	// this side's ends are not inherited so the pipes break when the child exits.
+	SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+	HANDLE hOutRead = NULL;
+	HANDLE hOutWrite = NULL;
+	HANDLE hInRead = NULL;
+	HANDLE hInWrite = NULL;
+	const bool gui = job.jobType == jobGUI;
+	bool handlesReady = gui;
+	if (!gui && ::CreatePipe(&hOutRead, &hOutWrite, &inherit, 0) &&
+		::CreatePipe(&hInRead, &hInWrite, &inherit, 0)) {
+		::SetHandleInformation(hOutRead, HANDLE_FLAG_INHERIT, 0);
+		::SetHandleInformation(hInWrite, HANDLE_FLAG_INHERIT, 0);
+		handlesReady = true;
+	}
+
+	STARTUPINFOW si = {};
+	si.cb = sizeof(si);
+	si.dwFlags = STARTF_USESHOWWINDOW;
+	si.wShowWindow = gui ? SW_SHOW : SW_HIDE;
+	if (!gui) {
+		si.dwFlags |= STARTF_USESTDHANDLES;
+		si.hStdInput = hInRead;
+		si.hStdOutput = hOutWrite;
+		si.hStdError = hOutWrite;
+	}
+
+	// Processes started by the tool join its job object so that cancelling
+	// ends all of them, not just the tool.
+	HANDLE hJob = ::CreateJobObject(NULL, NULL);
+	PROCESS_INFORMATION pi = {};
+	GUI::GUIString command = GUI::StringFromUTF8(job.command);
+	const bool started = handlesReady && ::CreateProcessW(
+		NULL, &command[0], NULL, NULL, !gui, CREATE_SUSPENDED | CREATE_NEW_PROCESS_GROUP,
+		NULL, job.directory.IsSet() ? job.directory.AsInternal() : NULL, &si, &pi);
+	CloseHandleOnce(hOutWrite);
+	CloseHandleOnce(hInRead);
+
+	if (started) {
+		if (hJob)
+			::AssignProcessToJobObject(hJob, pi.hProcess);
+		::ResumeThread(pi.hThread);
+		::CloseHandle(pi.hThread);
+	}
+
+	if (started && gui) {
+		// Windowed tools are left running and have no output to wait for.
+		exitStatus = 0;
+	} else if (started) {
+		// Input is written from another thread as a synchronous pipe would block
+		// while the tool is itself blocked writing output that is not being read.
+		std::thread inputWriter;
+		std::atomic<bool> stopInput(false);
+		if ((job.flags & jobHasInput) && !job.input.empty()) {
+			inputWriter = std::thread([this, &hInWrite, &stopInput]() {
+				size_t inputWritten = 0;
+				while (!stopInput && (inputWritten < job.input.length())) {
+					const DWORD lenBlock = static_cast<DWORD>(
+						std::min<size_t>(blockSize, job.input.length() - inputWritten));
+					DWORD lenWritten = 0;
+					if (!::WriteFile(hInWrite, job.input.c_str() + inputWritten, lenBlock, &lenWritten, NULL))
+						break;
+					inputWritten += lenWritten;
+				}
+				CloseHandleOnce(hInWrite);
+			});
+		} else {
+			CloseHandleOnce(hInWrite);
+		}
+
+		bool killed = false;
+		auto KillIfCancelling = [&]() {
+			if (Cancelling() && !killed) {
+				if (hJob)
+					::TerminateJobObject(hJob, 1);
+				else
+					::TerminateProcess(pi.hProcess, 1);
+				killed = true;
+			}
+		};
+
+		std::vector<char> data(blockSize);
+		bool exited = false;
+		for (;;) {
+			KillIfCancelling();
+			DWORD bytesAvailable = 0;
+			const bool open = ::PeekNamedPipe(hOutRead, NULL, 0, NULL, &bytesAvailable, NULL) != 0;
+			if (bytesAvailable > 0) {
+				DWORD bytesRead = 0;
+				if (::ReadFile(hOutRead, &data[0], std::min<DWORD>(bytesAvailable, static_cast<DWORD>(data.size())),
+					&bytesRead, NULL) && (bytesRead > 0)) {
+					AppendOutput(&data[0], bytesRead);
+				}
+				continue;
+			}
+			// A process the tool started may keep the pipe open so stop once the
+			// tool has exited and everything it wrote has been read.
+			if (!open || exited)
+				break;
+			exited = ::WaitForSingleObject(pi.hProcess, pollInterval) == WAIT_OBJECT_0;
+		}
+		// The tool may have closed its output while still running.
+		while (::WaitForSingleObject(pi.hProcess, pollInterval) == WAIT_TIMEOUT) {
+			KillIfCancelling();
+		}
+		if (inputWriter.joinable()) {
+			// A process started by the tool may have inherited its input and not
+			// read it, so a blocked write is cancelled until the writer ends.
+			stopInput = true;
+			while (::WaitForSingleObject(inputWriter.native_handle(), pollInterval / 10) == WAIT_TIMEOUT) {
+				::CancelSynchronousIo(inputWriter.native_handle());
+			}
+			inputWriter.join();
+		}
+		DWORD exitCode = 0;
+		if (!killed && ::GetExitCodeProcess(pi.hProcess, &exitCode))
+			exitStatus = static_cast<int>(exitCode);
+		else
+			exitStatus = -1;
+	} else {
+		const char *message = ">Failed to start process\n";
+		AppendOutput(message, strlen(message));
+		exitStatus = -1;
+	}
+	if (started)
+		::CloseHandle(pi.hProcess);
+	CloseHandleOnce(hInWrite);
+	CloseHandleOnce(hOutRead);
+	CloseHandleOnce(hJob);
+#elif defined(__unix__)
+	// Writing input to a tool that has exited must fail with EPIPE on this
+	// thread instead of raising SIGPIPE which would end the application.
+	sigset_t blockPipe;
+	sigemptyset(&blockPipe);
+	sigaddset(&blockPipe, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &blockPipe, NULL);
+
+	int pipeIn[2] = { -1, -1 };
+	int pipeOut[2] = { -1, -1 };
+	int pipeErr[2] = { -1, -1 };
+	pid_t pid = -1;
+	// The pipes are close-on-exec so that other tools started at the same time
+	// do not inherit them and hold them open. dup2 clears the flag on the copies
+	// that become the child's standard handles.
+	if ((pipe2(pipeIn, O_CLOEXEC) == 0) && (pipe2(pipeOut, O_CLOEXEC) == 0) && (pipe2(pipeErr, O_CLOEXEC) == 0)) {
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_adddup2(&actions, pipeIn[0], 0);
+		posix_spawn_file_actions_adddup2(&actions, pipeOut[1], 1);
+		posix_spawn_file_actions_adddup2(&actions, pipeErr[1], 2);
+
+		// The child starts with default signal handling and nothing blocked.
+		posix_spawnattr_t attributes;
+		posix_spawnattr_init(&attributes);
+		sigset_t noSignals;
+		sigemptyset(&noSignals);
+		posix_spawnattr_setsigmask(&attributes, &noSignals);
+		posix_spawnattr_setsigdefault(&attributes, &blockPipe);
+		// The child leads a new process group so cancelling can kill everything
+		// the shell starts.
+		posix_spawnattr_setpgroup(&attributes, 0);
+		posix_spawnattr_setflags(&attributes,
+			POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+		// The directory and command are passed as arguments rather than pasted
+		// into the script so they need no quoting.
+		const std::string directory = job.directory.IsSet() ? job.directory.AsUTF8() : std::string(".");
+		const char *argv[] = {
+			"/bin/sh", "-c", "cd -- \"$1\" && eval \"$2\"", "sh", directory.c_str(), job.command.c_str(), NULL
+		};
+		if (posix_spawn(&pid, argv[0], &actions, &attributes, const_cast<char **>(argv), environ) != 0) {
+			pid = -1;
+		}
+		posix_spawnattr_destroy(&attributes);
+		posix_spawn_file_actions_destroy(&actions);
+	}
+	CloseDescriptor(pipeIn[0]);
+	CloseDescriptor(pipeOut[1]);
+	CloseDescriptor(pipeErr[1]);
+
+	if (pid > 0) {
+		size_t inputWritten = 0;
+		if (!(job.flags & jobHasInput) || job.input.empty()) {
+			CloseDescriptor(pipeIn[1]);
+		} else {
+			fcntl(pipeIn[1], F_SETFL, fcntl(pipeIn[1], F_GETFL) | O_NONBLOCK);
+		}
+		std::vector<char> data(blockSize);
+		bool killed = false;
+		bool exited = false;
+		int status = 0;
+		while ((pipeOut[0] >= 0) || (pipeErr[0] >= 0)) {
+			if (Cancelling() && !killed) {
+				kill(-pid, SIGKILL);
+				killed = true;
+			}
+			pollfd fds[3] = {
+				{ pipeOut[0], POLLIN, 0 },
+				{ pipeErr[0], POLLIN, 0 },
+				{ pipeIn[1], POLLOUT, 0 },
+			};
+			// Negative descriptors are ignored by poll.
+			const int ready = poll(fds, 3, exited ? 0 : pollInterval);
+			if (ready < 0) {
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			// A process the tool started may keep the pipes open so stop once the
+			// tool has exited and everything it wrote has been read.
+			if (exited && (ready == 0))
+				break;
+			for (int stream = 0; stream < 2; stream++) {
+				if (fds[stream].revents & (POLLIN | POLLHUP | POLLERR)) {
+					int &fd = (stream == 0) ? pipeOut[0] : pipeErr[0];
+					const ssize_t lenRead = read(fd, &data[0], data.size());
+					if (lenRead > 0) {
+						AppendOutput(&data[0], lenRead);
+					} else if ((lenRead == 0) || (errno != EINTR && errno != EAGAIN)) {
+						CloseDescriptor(fd);
+					}
+				}
+			}
+			if (fds[2].revents & POLLOUT) {
+				const ssize_t lenWritten = write(pipeIn[1], job.input.c_str() + inputWritten,
+					job.input.length() - inputWritten);
+				if (lenWritten > 0)
+					inputWritten += lenWritten;
+				if ((lenWritten < 0 && errno != EAGAIN && errno != EINTR) || (inputWritten >= job.input.length()))
+					CloseDescriptor(pipeIn[1]);
+			} else if (fds[2].revents & (POLLERR | POLLHUP)) {
+				CloseDescriptor(pipeIn[1]);
+			}
+			if (!exited) {
+				const pid_t waited = waitpid(pid, &status, WNOHANG);
+				exited = (waited == pid) || ((waited < 0) && (errno != EINTR));
+				// Input left over after the tool exits is not for anything it started.
+				if (exited)
+					CloseDescriptor(pipeIn[1]);
+			}
+		}
+		while (!exited && (waitpid(pid, &status, 0) < 0) && (errno == EINTR)) {
+		}
+		if (WIFEXITED(status))
+			exitStatus = WEXITSTATUS(status);
+		else
+			exitStatus = -1;
+	} else {
+		const char *message = ">Failed to start process\n";
+		AppendOutput(message, strlen(message));
+		exitStatus = -1;
+	}
+	for (int *fd : { &pipeIn[1], &pipeOut[0], &pipeErr[0] }) {
+		CloseDescriptor(*fd);
+	}
+#else
+	const char *message = ">Tools can not be run on this platform\n";
+	AppendOutput(message, strlen(message));
+	exitStatus = -1;
+#endif
+	duration = commandTime.Duration();
+	// The runner may be deleted once it is completed so nothing is read from it after that.
+	WorkerListener *listener = pListener;
+	SetCompleted();
+	listener->PostOnMainThread(kWorkJobCompleted, this);
+}
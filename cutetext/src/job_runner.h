@@ -0,0 +1,39 @@
+// This file is part of CuteText project
+// Copyright (C) 2026 by the CuteText contributors
+// The LICENSE file describes the conditions under which this software may be distributed.
+/**
+ * @file job_runner.h
+ * @date 2026-10-18
+ * @brief Definition of class to run a command line job as a background task.
+ *
+ * @see https://github.com/cutetext/cutetext
+ */
+
+#ifndef JOBRUNNER_H
+#define JOBRUNNER_H
+
+/**
+ * Runs one command line job as a child process on a worker thread.
+ * Output from stdout and stderr is gathered into a buffer which the main
+ * thread drains whole, so a chatty tool costs one append per batch rather
+ * than one per read. Cancelling kills the child and any processes it started.
+ * The runner may be deleted as soon as FinishedJob is true.
+ */
+class JobRunner : public Worker {
+	std::unique_ptr<Mutex> outputMutex;
+	std::string output;
+	bool outputPosted;	///< A kWorkJobOutput has been posted and not yet drained
+	void AppendOutput(const char *s, size_t len);
+public:
+	WorkerListener *pListener;
+	Job job;
+	int exitStatus;
+	double duration;
+
+	JobRunner(WorkerListener *pListener_, const Job &job_);
+	~JobRunner() override;
+	void Execute() override;
+	std::string TakeOutput();
+};
+
+#endif
@@ -11,15 +11,25 @@
  */
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <algorithm>
 
 #include "Scintilla.h"
 
 #include "GUI.h"
 #include "ScintillaWindow.h"
+#include "string_helpers.h"
 
 #include "MatchMarker.h"
 
+namespace {
+
+/// Limit on the candidate positions remembered over all incremental search queries.
+const size_t maxMatchesKept = 4000000;
+
+}
+
 std::vector<LineRange> LinesBreak(GUI::ScintillaWindow *pSci) {
 	std::vector<LineRange> lineRanges;
 	if (pSci) {
@@ -43,7 +53,8 @@ std::vector<LineRange> LinesBreak(GUI::ScintillaWindow *pSci) {
 }
 
 MatchMarker::MatchMarker() :
-	pSci(0), styleMatch(-1), flagsMatch(0), indicator(0), bookMark(-1) {
+	pSci(0), styleMatch(-1), flagsMatch(0), indicator(0), bookMark(-1), keepMatches(false),
+	markingCandidates(false), filtering(false), candidateNext(0), startMarked(0), endMarked(0) {
 }
 
 MatchMarker::~MatchMarker() {
@@ -53,6 +64,7 @@ void MatchMarker::StartMatch(GUI::ScintillaWindow *pSci_,
 	const std::string &textMatch_, int flagsMatch_, int styleMatch_,
 	int indicator_, int bookMark_) {
 	lineRanges.clear();
+	ForgetMatches();
 	pSci = pSci_;
 	textMatch = textMatch_;
 	flagsMatch = flagsMatch_;
@@ -64,11 +76,156 @@ void MatchMarker::StartMatch(GUI::ScintillaWindow *pSci_,
 	Continue();
 }
 
+/**
+ * Mark the matches of an incremental search query. Matches of a query extended by
+ * typing can only start where the previous query matched so just those positions
+ * are checked. When characters are deleted the candidates remembered for the
+ * shorter query are used again. Candidates are checked and marked, then line ranges
+ * not yet searched for the query are searched, on idle as for StartMatch.
+ */
+void MatchMarker::StartIncrementalMatch(GUI::ScintillaWindow *pSci_,
+	const std::string &textMatch_, int flagsMatch_, int indicator_) {
+	if ((flagsMatch_ != flagsMatch) || (flagsMatch_ & SCFIND_REGEXP)) {
+		// Regular expressions may match differently when extended
+		ForgetMatches();
+	}
+	lineRanges.clear();
+	pSci = pSci_;
+	textMatch = textMatch_;
+	flagsMatch = flagsMatch_;
+	styleMatch = -1;
+	indicator = indicator_;
+	bookMark = -1;
+	if (flagsMatch & SCFIND_REGEXP) {
+		lineRanges = LinesBreak(pSci);
+		Continue();
+		return;
+	}
+	keepMatches = true;
+	// Candidates only partly checked against an earlier query can not be reused
+	StopCandidates();
+	while (!history.empty() && !StartsWith(textMatch, history.back().textMatch)) {
+		history.pop_back();
+	}
+	if (history.empty()) {
+		history.emplace_back(textMatch);
+		history.back().lineRanges = LinesBreak(pSci);
+	} else if (history.back().textMatch != textMatch) {
+		MatchSet extended(textMatch);
+		extended.lineRanges = history.back().lineRanges;
+		history.push_back(std::move(extended));
+		filtering = true;
+	}
+	markingCandidates = true;
+	candidateNext = 0;
+	startMarked = 0;
+	endMarked = 0;
+	lineRanges = history.back().lineRanges;
+	// Perform the initial marking immediately to avoid flashing
+	if (!Complete())
+		Continue();
+}
+
+/**
+ * Candidates for whole word matches need only start a word as more text may be typed
+ * to complete the word.
+ */
+int MatchMarker::CandidateFlags() const {
+	if (flagsMatch & SCFIND_WHOLEWORD)
+		return (flagsMatch & ~SCFIND_WHOLEWORD) | SCFIND_WORDSTART;
+	return flagsMatch;
+}
+
+/**
+ * Return the end of the match of textMatch starting at position or -1 if it does not match there.
+ */
+int MatchMarker::MatchEnd(int position, int flags) {
+	// Case folding may change the length of the text matched
+	const int lengthDocument = pSci->Call(SCI_GETLENGTH);
+	const int positionEnd = std::min(position + static_cast<int>(textMatch.length()) * 4, lengthDocument);
+	pSci->Call(SCI_SETSEARCHFLAGS, flags);
+	pSci->Call(SCI_SETTARGETSTART, position);
+	pSci->Call(SCI_SETTARGETEND, positionEnd);
+	const int posFound = pSci->CallString(
+		SCI_SEARCHINTARGET, textMatch.length(), textMatch.c_str());
+	return (posFound == position) ? pSci->Call(SCI_GETTARGETEND) : -1;
+}
+
+/**
+ * Whether a candidate, found with CandidateFlags, also matches with the full flags.
+ */
+bool MatchMarker::MatchesFully(const MatchCandidate &candidate) {
+	if ((flagsMatch & SCFIND_WHOLEWORD) && !(flagsMatch & SCFIND_WORDSTART))
+		return pSci->Call(SCI_ISRANGEWORD, candidate.position, candidate.end) != 0;
+	return true;
+}
+
+/**
+ * Mark remembered candidates for up to 250 ms. When the query has been extended each
+ * candidate of the previous query is first checked and kept, with the end of its
+ * match, when it still matches.
+ */
+void MatchMarker::ContinueCandidates() {
+	const MatchSet &source = history[history.size() - (filtering ? 2 : 1)];
+	const int flagsCandidate = CandidateFlags();
+	pSci->Call(SCI_SETINDICATORCURRENT, indicator);
+	GUI::ElapsedTime markElapsedTime;
+	while (candidateNext < source.candidates.size()) {
+		MatchCandidate candidate = source.candidates[candidateNext++];
+		if (filtering) {
+			candidate.end = MatchEnd(candidate.position, flagsCandidate);
+		}
+		if (candidate.end >= 0) {
+			if (filtering)
+				history.back().candidates.push_back(candidate);
+			// Candidates ascend within each line range searched and marks do not overlap
+			if (((candidate.position >= endMarked) || (candidate.position < startMarked)) &&
+				MatchesFully(candidate)) {
+				pSci->Call(SCI_INDICATORFILLRANGE, candidate.position, candidate.end - candidate.position);
+				startMarked = candidate.position;
+				endMarked = candidate.end;
+			}
+		}
+		if (((candidateNext % 1000) == 0) && (markElapsedTime.Duration() > 0.25))
+			return;
+	}
+	markingCandidates = false;
+	if (filtering) {
+		filtering = false;
+		// Forget the shortest queries which have the most candidates first
+		size_t kept = 0;
+		for (const MatchSet &matchSet : history)
+			kept += matchSet.candidates.size();
+		while ((kept > maxMatchesKept) && (history.size() > 1)) {
+			kept -= history.front().candidates.size();
+			history.erase(history.begin());
+		}
+	}
+}
+
+/**
+ * Abandon marking candidates along with any query whose candidates have not all been checked.
+ */
+void MatchMarker::StopCandidates() {
+	if (filtering && !history.empty())
+		history.pop_back();
+	markingCandidates = false;
+	filtering = false;
+	candidateNext = 0;
+}
+
 bool MatchMarker::Complete() const {
-	return lineRanges.empty();
+	return !markingCandidates && lineRanges.empty();
 }
 
 void MatchMarker::Continue() {
+	if (markingCandidates) {
+		ContinueCandidates();
+		return;
+	}
+	if (lineRanges.empty())
+		return;
+
 	const int segment = 200;
 
 	// Remove old indicators if any exist.
@@ -79,7 +236,11 @@ void MatchMarker::Continue() {
 	if (lineEndSegment > rangeSearch.lineEnd)
 		lineEndSegment = rangeSearch.lineEnd;
 
-	pSci->Call(SCI_SETSEARCHFLAGS, flagsMatch);
+	// Incremental search finds every candidate, including overlapping ones, and marks
+	// those that also match with the full flags.
+	const bool candidates = keepMatches && !history.empty();
+	const int flagsSearch = candidates ? CandidateFlags() : flagsMatch;
+	pSci->Call(SCI_SETSEARCHFLAGS, flagsSearch);
 	const int positionStart = pSci->Call(SCI_POSITIONFROMLINE, rangeSearch.lineStart);
 	const int positionEnd = pSci->Call(SCI_POSITIONFROMLINE, lineEndSegment);
 	pSci->Call(SCI_SETTARGETSTART, positionStart);
@@ -92,16 +253,38 @@ void MatchMarker::Continue() {
 	// Find the first occurrence of word.
 	int posFound = pSci->CallString(
 		SCI_SEARCHINTARGET, textMatch.length(), textMatch.c_str());
+	// Marks within this segment do not overlap
+	int endSegmentMarked = positionStart;
 	while (posFound != INVALID_POSITION) {
 		// Limit the search duration to 250 ms. Avoid to freeze editor for huge lines.
 		if (searchElapsedTime.Duration() > 0.25) {
 			// Clear all indicators because timer has expired.
 			pSci->Call(SCI_INDICATORCLEARRANGE, 0, pSci->Call(SCI_GETLENGTH));
 			lineRanges.clear();
+			ForgetMatches();
 			break;
 		}
 		int posEndFound = pSci->Call(SCI_GETTARGETEND);
 
+		if (candidates) {
+			const MatchCandidate candidate(posFound, posEndFound);
+			if (keepMatches) {
+				history.back().candidates.push_back(candidate);
+				if (history.back().candidates.size() > maxMatchesKept)
+					ForgetMatches();
+			}
+			if ((posFound >= endSegmentMarked) && MatchesFully(candidate)) {
+				pSci->Call(SCI_INDICATORFILLRANGE, posFound, posEndFound - posFound);
+				endSegmentMarked = posEndFound;
+			}
+			// Try to find next occurrence of word, which may overlap this one.
+			pSci->Call(SCI_SETTARGETSTART, pSci->Call(SCI_POSITIONAFTER, posFound));
+			pSci->Call(SCI_SETTARGETEND, positionEnd);
+			posFound = pSci->CallString(
+				SCI_SEARCHINTARGET, textMatch.length(), textMatch.c_str());
+			continue;
+		}
+
 		if ((styleMatch < 0) || (styleMatch == pSci->Call(SCI_GETSTYLEAT, posFound))) {
 			pSci->Call(SCI_INDICATORFILLRANGE, posFound, posEndFound - posFound);
 			if (bookMark >= 0) {
@@ -129,9 +312,25 @@ void MatchMarker::Continue() {
 			lineRanges[0].lineStart = lineEndSegment;
 		}
 	}
+	if (keepMatches && !history.empty()) {
+		history.back().lineRanges = lineRanges;
+	}
 }
 
 void MatchMarker::Stop() {
 	pSci = NULL;
 	lineRanges.clear();
+	StopCandidates();
+}
+
+/**
+ * Forget remembered incremental search candidates, which is needed whenever the
+ * document is modified or another document is shown.
+ */
+void MatchMarker::ForgetMatches() {
+	keepMatches = false;
+	markingCandidates = false;
+	filtering = false;
+	candidateNext = 0;
+	history.clear();
 }
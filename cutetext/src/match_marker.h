@@ -18,6 +18,23 @@ struct LineRange {
 
 std::vector<LineRange> LinesBreak(GUI::ScintillaWindow *pSci);
 
+struct MatchCandidate {
+	int position;
+	int end;
+	MatchCandidate(int position_, int end_) : position(position_), end(end_) {}
+};
+
+/**
+ * Ranges where the text of one incremental search query may match along with
+ * the line ranges that have not yet been searched for it.
+ */
+struct MatchSet {
+	std::string textMatch;
+	std::vector<MatchCandidate> candidates;
+	std::vector<LineRange> lineRanges;
+	explicit MatchSet(const std::string &textMatch_) : textMatch(textMatch_) {}
+};
+
 class MatchMarker {
 	GUI::ScintillaWindow *pSci;
 	std::string textMatch;
@@ -26,13 +43,32 @@ class MatchMarker {
 	int indicator;
 	int bookMark;
 	std::vector<LineRange> lineRanges;
+	// Incremental search remembers the candidates for each query typed so that
+	// extending or shortening the query does not search the whole document again.
+	bool keepMatches;
+	std::vector<MatchSet> history;
+	// The remembered candidates are marked on idle. When the query has been extended
+	// those of the previous query are first checked against the new text.
+	bool markingCandidates;
+	bool filtering;
+	size_t candidateNext;
+	int startMarked;
+	int endMarked;
+	int CandidateFlags() const;
+	int MatchEnd(int position, int flags);
+	bool MatchesFully(const MatchCandidate &candidate);
+	void ContinueCandidates();
+	void StopCandidates();
 public:
 	MatchMarker();
 	~MatchMarker();
 	void StartMatch(GUI::ScintillaWindow *pSci_,
 		const std::string &textMatch_, int flagsMatch_, int styleMatch_,
 		int indicator_, int bookMark_);
+	void StartIncrementalMatch(GUI::ScintillaWindow *pSci_,
+		const std::string &textMatch_, int flagsMatch_, int indicator_);
 	bool Complete() const;
 	void Continue();
 	void Stop();
+	void ForgetMatches();
 };
@@ -43,6 +43,7 @@ int ScintillaWindow::Call(unsigned int msg, uptr_t wParam, sptr_t lParam) {
 	switch (msg) {
 	case SCI_CREATEDOCUMENT:
 	case SCI_CREATELOADER:
+	case SCI_CREATETEXTSNAPSHOT:
 	case SCI_PRIVATELEXERCALL:
 	case SCI_GETDIRECTFUNCTION:
 	case SCI_GETDIRECTPOINTER:
@@ -56,11 +56,13 @@ public:
 		Lock lock(mutex.get());
 		jobProgress += increment;
 	}
+	/// Ask the worker to stop without waiting for it.
+	void RequestCancel() {
+		Lock lock(mutex.get());
+		cancelling = true;
+	}
 	virtual void Cancel() {
-		{
-			Lock lock(mutex.get());
-			cancelling = true;
-		}
+		RequestCancel();
 		// Wait for writing thread to finish
 		for (;;) {
 			Lock lock(mutex.get());
@@ -274,12 +274,7 @@ public:
     uptr_t EventLoop();
     void OutputAppendEncodedStringSynchronised(const GUI::GUIString &s, int codePageDocument);
     void ResetExecution();
-    void ExecuteNext();
-    DWORD ExecuteOne(const Job &jobToRun);
-    void ProcessExecute();
     void ShellExec(const std::string &cmd, const char *dir);
-    void Execute() override;
-    void StopExecute() override;
     void AddCommand(const std::string &cmd, const std::string &dir, JobSubsystem jobType, const std::string &input = "", int flags = 0) override;
 
     bool PerformOnNewThread(Worker *pWorker) override;
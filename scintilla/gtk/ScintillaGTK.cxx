@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
+#include <cerrno>
 #include <cctype>
 #include <cstdio>
 #include <ctime>
@@ -714,26 +715,31 @@ std::string ConvertText(const char *s, size_t len, const char *charSetDest,
 	std::string destForm;
 	Converter conv(charSetDest, charSetSource, transliterations);
 	if (conv) {
-		gsize outLeft = len*3+1;
-		destForm = std::string(outLeft, '\0');
+		// Convert through a bounded block rather than allocating 3 times the
+		// input up front so converting a huge clipping stays memory-bounded.
+		const gsize blockSize = 0x10000;
+		std::vector<char> block(std::min(len * 3 + 1, blockSize));
+		destForm.reserve(len);
 		// g_iconv does not actually write to its input argument so safe to cast away const
 		char *pin = const_cast<char *>(s);
 		gsize inLeft = len;
-		char *putf = &destForm[0];
-		char *pout = putf;
-		gsize conversions = conv.Convert(&pin, &inLeft, &pout, &outLeft);
-		if (conversions == sizeFailure) {
-			if (!silent) {
-				if (len == 1)
-					fprintf(stderr, "iconv %s->%s failed for %0x '%s'\n",
-						charSetSource, charSetDest, (unsigned char)(*s), s);
-				else
-					fprintf(stderr, "iconv %s->%s failed for %s\n",
-						charSetSource, charSetDest, s);
+		while (inLeft > 0) {
+			char *pout = &block[0];
+			gsize outLeft = block.size();
+			const gsize conversions = conv.Convert(&pin, &inLeft, &pout, &outLeft);
+			destForm.append(&block[0], pout - &block[0]);
+			if ((conversions == sizeFailure) && (errno != E2BIG)) {
+				if (!silent) {
+					if (len == 1)
+						fprintf(stderr, "iconv %s->%s failed for %0x '%s'\n",
+							charSetSource, charSetDest, (unsigned char)(*s), s);
+					else
+						fprintf(stderr, "iconv %s->%s failed for %s\n",
+							charSetSource, charSetDest, s);
+				}
+				destForm = std::string();
+				break;
 			}
-			destForm = std::string();
-		} else {
-			destForm.resize(pout - putf);
 		}
 	} else {
 		fprintf(stderr, "Can not iconv %s %s\n", charSetDest, charSetSource);
@@ -1464,28 +1470,28 @@ void ScintillaGTK::ReceivedDrop(GtkSelectionData *selection_data) {
 
 
 void ScintillaGTK::GetSelection(GtkSelectionData *selection_data, guint info, SelectionText *text) {
+	// Serve the stored clipping directly and only build a temporary when the
+	// text has to be transformed so large clippings are not copied again for
+	// every request made by the clipboard.
+	const char *textData = text->Data();
+	size_t len = text->Length();
+
 #if PLAT_GTK_WIN32
 	// GDK on Win32 expands any \n into \r\n, so make a copy of
-	// the clip text now with newlines converted to \n.  Use { } to hide symbols
-	// from code below
-	std::unique_ptr<SelectionText> newline_normalized;
-	{
-		std::string tmpstr = Document::TransformLineEnds(text->Data(), text->Length(), SC_EOL_LF);
-		newline_normalized.reset(new SelectionText());
-		newline_normalized->Copy(tmpstr, SC_CP_UTF8, 0, text->rectangular, false);
-		text = newline_normalized.get();
-	}
+	// the clip text now with newlines converted to \n.
+	const std::string newlineNormalized = Document::TransformLineEnds(textData, len, SC_EOL_LF);
+	textData = newlineNormalized.c_str();
+	len = newlineNormalized.length();
 #endif
 
 	// Convert text to utf8 if it isn't already
-	std::unique_ptr<SelectionText> converted;
+	std::string converted;
 	if ((text->codePage != SC_CP_UTF8) && (info == TARGET_UTF8_STRING)) {
 		const char *charSet = ::CharacterSetID(text->characterSet);
 		if (*charSet) {
-			std::string tmputf = ConvertText(text->Data(), text->Length(), "UTF-8", charSet, false);
-			converted.reset(new SelectionText());
-			converted->Copy(tmputf, SC_CP_UTF8, 0, text->rectangular, false);
-			text = converted.get();
+			converted = ConvertText(textData, len, "UTF-8", charSet, false);
+			textData = converted.c_str();
+			len = converted.length();
 		}
 	}
 
@@ -1496,19 +1502,17 @@ void ScintillaGTK::GetSelection(GtkSelectionData *selection_data, guint info, Se
 	// All other tested aplications behave benignly by ignoring the \0.
 	// The #if is here because on Windows cfColumnSelect clip entry is used
 	// instead as standard indicator of rectangularness (so no need to kludge)
-	const char *textData = text->Data();
-	int len = text->Length();
 #if PLAT_GTK_WIN32 == 0
 	if (text->rectangular)
 		len++;
 #endif
 
 	if (info == TARGET_UTF8_STRING) {
-		gtk_selection_data_set_text(selection_data, textData, len);
+		gtk_selection_data_set_text(selection_data, textData, static_cast<gint>(len));
 	} else {
 		gtk_selection_data_set(selection_data,
 			static_cast<GdkAtom>(GDK_SELECTION_TYPE_STRING),
-			8, reinterpret_cast<const guchar *>(textData), len);
+			8, reinterpret_cast<const guchar *>(textData), static_cast<gint>(len));
 	}
 }
 
@@ -0,0 +1,279 @@
+// Scintilla source code edit control
+/** @file HeadlessDocument.cxx
+ ** Document without a view for loading, lexing and transforming text in bulk.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "LexerModule.h"
+#include "Catalogue.h"
+
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "CaseConvert.h"
+#include "Document.h"
+
+#include "HeadlessDocument.h"
+
+namespace Scintilla {
+
+namespace {
+
+// Files are read and styles retrieved in blocks of this size.
+constexpr size_t blockSize = 128 * 1024;
+
+}
+
+/**
+ * Owns the lexer instance for a HeadlessDocument. The Document deletes it.
+ */
+class HeadlessLexer : public LexInterface {
+public:
+	explicit HeadlessLexer(Document *pdoc_) : LexInterface(pdoc_) {
+	}
+	~HeadlessLexer() override {
+		if (instance) {
+			instance->Release();
+			instance = nullptr;
+		}
+	}
+	bool SetLexerModule(const LexerModule *lex) {
+		if (!lex)
+			return false;
+		if (instance) {
+			instance->Release();
+			instance = nullptr;
+		}
+		instance = lex->Create();
+		pdoc->LexerChanged();
+		return true;
+	}
+	void PropSet(const char *key, const char *val) {
+		if (instance) {
+			const Sci_Position firstModification = instance->PropertySet(key, val);
+			if (firstModification >= 0) {
+				pdoc->ModifiedAt(firstModification);
+			}
+		}
+	}
+	void SetWordList(int n, const char *wl) {
+		if (instance) {
+			const Sci_Position firstModification = instance->WordListSet(n, wl);
+			if (firstModification >= 0) {
+				pdoc->ModifiedAt(firstModification);
+			}
+		}
+	}
+};
+
+void HeadlessInitialise() {
+	static std::once_flag initialised;
+	std::call_once(initialised, []() {
+		// These tables are filled in on first use so must be complete before
+		// documents on different threads can read them.
+		Scintilla_LinkLexers();
+		ConverterFor(CaseConversionFold);
+		ConverterFor(CaseConversionUpper);
+		ConverterFor(CaseConversionLower);
+	});
+}
+
+HeadlessDocument::HeadlessDocument(int options) : pdoc(nullptr), plexer(nullptr) {
+	HeadlessInitialise();
+	pdoc = new Document(options);
+	pdoc->AddRef();
+	pdoc->SetUndoCollection(false);
+	plexer = new HeadlessLexer(pdoc);
+	pdoc->SetLexInterface(plexer);
+	SetCodePage(SC_CP_UTF8);
+}
+
+HeadlessDocument::~HeadlessDocument() {
+	// Releasing the document also deletes plexer
+	pdoc->Release();
+	pdoc = nullptr;
+	plexer = nullptr;
+}
+
+Document *HeadlessDocument::GetDocument() const noexcept {
+	return pdoc;
+}
+
+bool HeadlessDocument::LoadFile(const char *path) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	pdoc->DeleteChars(0, pdoc->Length());
+	if (fseek(fp, 0, SEEK_END) == 0) {
+		const long size = ftell(fp);
+		if (size > 0)
+			pdoc->Allocate(size);
+		fseek(fp, 0, SEEK_SET);
+	}
+	ILoader *loader = pdoc;
+	std::vector<char> data(blockSize);
+	int status = SC_STATUS_OK;
+	size_t lenBlock = fread(&data[0], 1, data.size(), fp);
+	while ((lenBlock > 0) && (status == SC_STATUS_OK)) {
+		status = loader->AddData(&data[0], lenBlock);
+		lenBlock = fread(&data[0], 1, data.size(), fp);
+	}
+	const bool readFailed = ferror(fp) != 0;
+	fclose(fp);
+	loader->ConvertToDocument();
+	return !readFailed && (status == SC_STATUS_OK);
+}
+
+void HeadlessDocument::LoadText(const char *text, Sci_Position length) {
+	pdoc->DeleteChars(0, pdoc->Length());
+	pdoc->Allocate(length);
+	ILoader *loader = pdoc;
+	loader->AddData(text, length);
+	loader->ConvertToDocument();
+}
+
+bool HeadlessDocument::SaveFile(const char *path) {
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+		return false;
+	const size_t length = pdoc->Length();
+	const bool written = fwrite(pdoc->BufferPointer(), 1, length, fp) == length;
+	return (fclose(fp) == 0) && written;
+}
+
+Sci_Position HeadlessDocument::Length() const {
+	return pdoc->Length();
+}
+
+std::string HeadlessDocument::Text() const {
+	return TextRange(0, pdoc->Length());
+}
+
+std::string HeadlessDocument::TextRange(Sci_Position start, Sci_Position end) const {
+	start = std::clamp<Sci_Position>(start, 0, pdoc->Length());
+	end = std::clamp<Sci_Position>(end, start, pdoc->Length());
+	std::string text(end - start, '\0');
+	pdoc->GetCharRange(&text[0], start, end - start);
+	return text;
+}
+
+void HeadlessDocument::SetCodePage(int codePage) {
+	pdoc->SetDBCSCodePage(codePage);
+	if (codePage == SC_CP_UTF8) {
+		pdoc->SetCaseFolder(new CaseFolderUnicode());
+	} else {
+		CaseFolderTable *pcf = new CaseFolderTable();
+		pcf->StandardASCII();
+		pdoc->SetCaseFolder(pcf);
+	}
+}
+
+bool HeadlessDocument::SetLexerLanguage(const char *language) {
+	return plexer->SetLexerModule(Catalogue::Find(language));
+}
+
+void HeadlessDocument::SetProperty(const char *key, const char *value) {
+	plexer->PropSet(key, value);
+}
+
+void HeadlessDocument::SetKeyWords(int keyWordSet, const char *keyWords) {
+	plexer->SetWordList(keyWordSet, keyWords);
+}
+
+void HeadlessDocument::Colourise() {
+	pdoc->EnsureStyledTo(pdoc->Length());
+}
+
+int HeadlessDocument::StyleAt(Sci_Position position) const {
+	return pdoc->StyleIndexAt(position);
+}
+
+int HeadlessDocument::FoldLevel(Sci_Position line) const {
+	return pdoc->GetLevel(line);
+}
+
+void HeadlessDocument::StyledRuns(Sci_Position start, Sci_Position end, std::vector<StyledRun> &runs) const {
+	start = std::clamp<Sci_Position>(start, 0, pdoc->Length());
+	end = std::clamp<Sci_Position>(end, start, pdoc->Length());
+	std::vector<unsigned char> styles(std::min<size_t>(blockSize, end - start));
+	Sci_Position position = start;
+	while (position < end) {
+		const Sci_Position lengthBlock = std::min<Sci_Position>(styles.size(), end - position);
+		pdoc->GetStyleRange(&styles[0], position, lengthBlock);
+		for (Sci_Position i = 0; i < lengthBlock; i++) {
+			const int style = styles[i];
+			if (!runs.empty() && (runs.back().style == style) &&
+				(runs.back().start + runs.back().length == position + i)) {
+				runs.back().length++;
+			} else {
+				runs.push_back({position + i, 1, style});
+			}
+		}
+		position += lengthBlock;
+	}
+}
+
+int HeadlessDocument::ReplaceAll(const char *find, const char *replacement, int flags) {
+	const Sci::Position lengthFind = strlen(find);
+	if (lengthFind == 0)
+		return 0;
+	const Sci::Position lengthReplacement = strlen(replacement);
+	int replacements = 0;
+	Sci::Position start = 0;
+	Sci::Position end = pdoc->Length();
+	while (start <= end) {
+		Sci::Position lengthFound = lengthFind;
+		const Sci::Position position = pdoc->FindText(start, end, find, flags, &lengthFound);
+		if (position < 0)
+			break;
+		const char *text = replacement;
+		Sci::Position lengthText = lengthReplacement;
+		if (flags & SCFIND_REGEXP) {
+			text = pdoc->SubstituteByPosition(replacement, &lengthText);
+		}
+		pdoc->DeleteChars(position, lengthFound);
+		const Sci::Position lengthInserted = pdoc->InsertString(position, text, lengthText);
+		end += lengthInserted - lengthFound;
+		start = position + lengthInserted;
+		replacements++;
+		if (lengthFound == 0) {
+			// Empty match so move on a character to avoid matching the same place again
+			if (start >= end)
+				break;
+			start = pdoc->MovePositionOutsideChar(start + 1, 1, false);
+		}
+	}
+	return replacements;
+}
+
+void HeadlessDocument::ConvertLineEnds(int eolMode) {
+	pdoc->eolMode = eolMode;
+	pdoc->ConvertLineEnds(eolMode);
+}
+
+}
@@ -0,0 +1,87 @@
+// Scintilla source code edit control
+/** @file HeadlessDocument.h
+ ** Document without a view for loading, lexing and transforming text in bulk.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef HEADLESSDOCUMENT_H
+#define HEADLESSDOCUMENT_H
+
+namespace Scintilla {
+
+class Document;
+class HeadlessLexer;
+
+/// A run of text in a single style.
+struct StyledRun {
+	Sci_Position start;
+	Sci_Position length;
+	int style;
+};
+
+/**
+ * Wraps a Document so that it can be used in a process without any user interface.
+ * Each HeadlessDocument should only be used by one thread at a time but different
+ * documents may be used on different threads at the same time. The lexer catalogue
+ * and other shared tables are only read after HeadlessInitialise.
+ * Undo collection is off as bulk operations do not need it.
+ */
+class HeadlessDocument {
+	Document *pdoc;
+	HeadlessLexer *plexer;
+public:
+	/// options is a combination of SC_DOCUMENTOPTION_* values.
+	explicit HeadlessDocument(int options=SC_DOCUMENTOPTION_DEFAULT);
+	// Deleted so HeadlessDocument objects can not be copied.
+	HeadlessDocument(const HeadlessDocument &) = delete;
+	HeadlessDocument(HeadlessDocument &&) = delete;
+	HeadlessDocument &operator=(const HeadlessDocument &) = delete;
+	HeadlessDocument &operator=(HeadlessDocument &&) = delete;
+	~HeadlessDocument();
+
+	/// The document is available for operations not wrapped here.
+	Document *GetDocument() const noexcept;
+
+	/// Replace the contents with the text of a file, loaded in blocks through ILoader.
+	/// @return false if the file could not be read.
+	bool LoadFile(const char *path);
+	/// Replace the contents with text, loaded through ILoader.
+	void LoadText(const char *text, Sci_Position length);
+	/// @return false if the file could not be written.
+	bool SaveFile(const char *path);
+
+	Sci_Position Length() const;
+	std::string Text() const;
+	std::string TextRange(Sci_Position start, Sci_Position end) const;
+	/// SC_CP_UTF8 or a DBCS code page or 0 for single byte.
+	void SetCodePage(int codePage);
+
+	/// Choose the lexer by name from the lexer catalogue. Properties and keywords
+	/// apply to the current lexer so should be set after this.
+	/// @return false if there is no lexer with that name.
+	bool SetLexerLanguage(const char *language);
+	void SetProperty(const char *key, const char *value);
+	void SetKeyWords(int keyWordSet, const char *keyWords);
+	/// Lex and fold the whole document.
+	void Colourise();
+
+	int StyleAt(Sci_Position position) const;
+	int FoldLevel(Sci_Position line) const;
+	/// Append the runs of styles between start and end, after Colourise.
+	void StyledRuns(Sci_Position start, Sci_Position end, std::vector<StyledRun> &runs) const;
+
+	/// Replace each match of find with replacement. flags are SCFIND_* values and
+	/// with SCFIND_REGEXP the replacement may contain \0..\9 tags.
+	/// @return the number of replacements.
+	int ReplaceAll(const char *find, const char *replacement, int flags);
+	/// eolMode is SC_EOL_CRLF, SC_EOL_CR or SC_EOL_LF.
+	void ConvertLineEnds(int eolMode);
+};
+
+/// Prepare the tables shared between documents. Safe to call from any thread and
+/// called by the HeadlessDocument constructor.
+void HeadlessInitialise();
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+// Scintilla source code edit control
+/** @file PlatHeadless.cxx
+ ** Implementation of the platform services needed without a user interface.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+
+#include <string_view>
+#include <vector>
+#include <memory>
+
+#include "Platform.h"
+
+namespace Scintilla {
+
+void Platform::DebugDisplay(const char *s) {
+	fprintf(stderr, "%s", s);
+}
+
+//#define TRACE
+
+#ifdef TRACE
+void Platform::DebugPrintf(const char *format, ...) {
+	char buffer[2000];
+	va_list pArguments;
+	va_start(pArguments, format);
+	vsnprintf(buffer, sizeof(buffer), format, pArguments);
+	va_end(pArguments);
+	Platform::DebugDisplay(buffer);
+}
+#else
+void Platform::DebugPrintf(const char *, ...) {}
+
+#endif
+
+// No pop ups without a user interface
+bool Platform::ShowAssertionPopUps(bool) {
+	return false;
+}
+
+void Platform::Assert(const char *c, const char *file, int line) {
+	char buffer[2000];
+	snprintf(buffer, sizeof(buffer), "Assertion [%s] failed at %s %d\n", c, file, line);
+	Platform::DebugDisplay(buffer);
+	abort();
+}
+
+}
@@ -15,6 +15,7 @@
 
 #include <utility>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <algorithm>
@@ -223,14 +224,68 @@ bool IsStreamCommentStyle(int style) noexcept {
 		style == SCE_C_COMMENTDOCKEYWORDERROR;
 }
 
+struct SymbolValue {
+	std::string value;
+	std::string arguments;
+	SymbolValue(const std::string &value_="", const std::string &arguments_="") : value(value_), arguments(arguments_) {
+	}
+	SymbolValue &operator = (const std::string &value_) {
+		value = value_;
+		arguments.clear();
+		return *this;
+	}
+	bool IsMacro() const noexcept {
+		return !arguments.empty();
+	}
+};
+
+// Heterogeneous lookup allows finding symbols from a std::string_view without allocating.
+typedef std::map<std::string, SymbolValue, std::less<>> SymbolTable;
+
 struct PPDefinition {
 	Sci_Position line;
 	std::string key;
-	std::string value;
+	SymbolValue value;
 	bool isUndef;
-	std::string arguments;
-	PPDefinition(Sci_Position line_, const std::string &key_, const std::string &value_, bool isUndef_ = false, const std::string &arguments_="") :
-		line(line_), key(key_), value(value_), isUndef(isUndef_), arguments(arguments_) {
+	PPDefinition(Sci_Position line_, const std::string &key_, const SymbolValue &value_, bool isUndef_ = false) :
+		line(line_), key(key_), value(value_), isUndef(isUndef_) {
+	}
+};
+
+// Symbols defined and undefined by preprocessor lines in the document.
+// Definitions are kept in line order along with a stack of definitions for each symbol
+// so that finding the current definition of a symbol and removing the definitions after
+// a modification do not depend on the number of preceding definitions.
+class PPSymbols {
+	std::vector<PPDefinition> history;
+	std::map<std::string, std::vector<size_t>, std::less<>> definitions;	// Indices into history
+public:
+	void Clear() {
+		history.clear();
+		definitions.clear();
+	}
+	void Add(const PPDefinition &ppDef) {
+		definitions[ppDef.key].push_back(history.size());
+		history.push_back(ppDef);
+	}
+	// Remove the definitions from a line onwards and return whether there were any.
+	bool TruncateFrom(Sci_Position line) {
+		const size_t sizeHistory = history.size();
+		while (!history.empty() && (history.back().line >= line)) {
+			std::map<std::string, std::vector<size_t>, std::less<>>::iterator it = definitions.find(history.back().key);
+			it->second.pop_back();
+			if (it->second.empty())
+				definitions.erase(it);
+			history.pop_back();
+		}
+		return history.size() != sizeHistory;
+	}
+	// The most recent #define or #undef of a symbol or nullptr if the document has neither.
+	const PPDefinition *Latest(std::string_view name) const {
+		std::map<std::string, std::vector<size_t>, std::less<>>::const_iterator it = definitions.find(name);
+		if (it == definitions.end())
+			return nullptr;
+		return &history[it->second.back()];
 	}
 };
 
@@ -475,28 +530,13 @@ class LexerCPP : public ILexer4 {
 	CharacterSet setLogicalOp;
 	CharacterSet setWordStart;
 	PPStates vlls;
-	std::vector<PPDefinition> ppDefineHistory;
+	PPSymbols ppSymbols;
 	WordList keywords;
 	WordList keywords2;
 	WordList keywords3;
 	WordList keywords4;
 	WordList ppDefinitions;
 	WordList markerList;
-	struct SymbolValue {
-		std::string value;
-		std::string arguments;
-		SymbolValue(const std::string &value_="", const std::string &arguments_="") : value(value_), arguments(arguments_) {
-		}
-		SymbolValue &operator = (const std::string &value_) {
-			value = value_;
-			arguments.clear();
-			return *this;
-		}
-		bool IsMacro() const noexcept {
-			return !arguments.empty();
-		}
-	};
-	typedef std::map<std::string, SymbolValue> SymbolTable;
 	SymbolTable preprocessorDefinitionsStart;
 	OptionsCPP options;
 	OptionSetCPP osCPP;
@@ -641,9 +681,11 @@ public:
 	static int MaskActive(int style) noexcept {
 		return style & ~activeFlag;
 	}
-	void EvaluateTokens(std::vector<std::string> &tokens, const SymbolTable &preprocessorDefinitions);
+	const SymbolValue *FindSymbol(std::string_view name) const;
+	void EvaluateTokens(std::vector<std::string> &tokens);
 	std::vector<std::string> Tokenize(const std::string &expr) const;
-	bool EvaluateExpression(const std::string &expr, const SymbolTable &preprocessorDefinitions);
+	bool EvaluateSimpleExpression(std::string_view expr, bool &result) const;
+	bool EvaluateExpression(const std::string &expr);
 };
 
 Sci_Position SCI_METHOD LexerCPP::PropertySet(const char *key, const char *val) {
@@ -774,25 +816,13 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 
 	bool definitionsChanged = false;
 
-	// Truncate ppDefineHistory before current line
+	// Remove definitions from current line onwards as they will be found again
 
 	if (!options.updatePreprocessor)
-		ppDefineHistory.clear();
+		ppSymbols.Clear();
 
-	std::vector<PPDefinition>::iterator itInvalid = std::find_if(ppDefineHistory.begin(), ppDefineHistory.end(),
-		[lineCurrent](const PPDefinition &p) { return p.line >= lineCurrent; });
-	if (itInvalid != ppDefineHistory.end()) {
-		ppDefineHistory.erase(itInvalid, ppDefineHistory.end());
+	if (ppSymbols.TruncateFrom(lineCurrent))
 		definitionsChanged = true;
-	}
-
-	SymbolTable preprocessorDefinitions = preprocessorDefinitionsStart;
-	for (const PPDefinition &ppDef : ppDefineHistory) {
-		if (ppDef.isUndef)
-			preprocessorDefinitions.erase(ppDef.key);
-		else
-			preprocessorDefinitions[ppDef.key] = SymbolValue(ppDef.value, ppDef.arguments);
-	}
 
 	std::string rawStringTerminator = rawStringTerminators.ValueAt(lineCurrent-1);
 	SparseState<std::string> rawSTNew(lineCurrent);
@@ -1253,11 +1283,11 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 							const bool isIfDef = sc.Match("ifdef");
 							const int startRest = isIfDef ? 5 : 6;
 							std::string restOfLine = GetRestOfLine(styler, sc.currentPos + startRest + 1, false);
-							bool foundDef = preprocessorDefinitions.find(restOfLine) != preprocessorDefinitions.end();
+							const bool foundDef = FindSymbol(restOfLine) != nullptr;
 							preproc.StartSection(isIfDef == foundDef);
 						} else if (sc.Match("if")) {
 							std::string restOfLine = GetRestOfLine(styler, sc.currentPos + 2, true);
-							const bool ifGood = EvaluateExpression(restOfLine, preprocessorDefinitions);
+							const bool ifGood = EvaluateExpression(restOfLine);
 							preproc.StartSection(ifGood);
 						} else if (sc.Match("else")) {
 							if (!preproc.CurrentIfTaken()) {
@@ -1276,7 +1306,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 							if (!preproc.CurrentIfTaken()) {
 								// Similar to #if
 								std::string restOfLine = GetRestOfLine(styler, sc.currentPos + 2, true);
-								const bool ifGood = EvaluateExpression(restOfLine, preprocessorDefinitions);
+								const bool ifGood = EvaluateExpression(restOfLine);
 								if (ifGood) {
 									preproc.InvertCurrentLevel();
 									activitySet = preproc.IsInactive() ? activeFlag : 0;
@@ -1315,8 +1345,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 									std::string value;
 									if (startValue < restOfLine.length())
 										value = restOfLine.substr(startValue);
-									preprocessorDefinitions[key] = SymbolValue(value, args);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value, false, args));
+									ppSymbols.Add(PPDefinition(lineCurrent, key, SymbolValue(value, args)));
 									definitionsChanged = true;
 								} else {
 									// Value
@@ -1326,8 +1355,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 									std::string value = restOfLine.substr(startValue);
 									if (OnlySpaceOrTab(value))
 										value = "1";	// No value defaults to 1
-									preprocessorDefinitions[key] = value;
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value));
+									ppSymbols.Add(PPDefinition(lineCurrent, key, SymbolValue(value)));
 									definitionsChanged = true;
 								}
 							}
@@ -1337,8 +1365,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 								std::vector<std::string> tokens = Tokenize(restOfLine);
 								if (tokens.size() >= 1) {
 									const std::string key = tokens[0];
-									preprocessorDefinitions.erase(key);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, "", true));
+									ppSymbols.Add(PPDefinition(lineCurrent, key, SymbolValue(), true));
 									definitionsChanged = true;
 								}
 							}
@@ -1483,7 +1510,16 @@ void SCI_METHOD LexerCPP::Fold(Sci_PositionU startPos, Sci_Position length, int
 	}
 }
 
-void LexerCPP::EvaluateTokens(std::vector<std::string> &tokens, const SymbolTable &preprocessorDefinitions) {
+const SymbolValue *LexerCPP::FindSymbol(std::string_view name) const {
+	const PPDefinition *ppDef = ppSymbols.Latest(name);
+	if (ppDef) {
+		return ppDef->isUndef ? nullptr : &ppDef->value;
+	}
+	SymbolTable::const_iterator it = preprocessorDefinitionsStart.find(name);
+	return (it != preprocessorDefinitionsStart.end()) ? &it->second : nullptr;
+}
+
+void LexerCPP::EvaluateTokens(std::vector<std::string> &tokens) {
 
 	// Remove whitespace tokens
 	tokens.erase(std::remove_if(tokens.begin(), tokens.end(), OnlySpaceOrTab), tokens.end());
@@ -1498,8 +1534,7 @@ void LexerCPP::EvaluateTokens(std::vector<std::string> &tokens, const SymbolTabl
 					tokens.erase(tokens.begin() + i + 1, tokens.begin() + i + 3);
 				} else if (((i+3)<tokens.size()) && (tokens[i+3] == ")")) {
 					// defined(<identifier>)
-					SymbolTable::const_iterator it = preprocessorDefinitions.find(tokens[i+2]);
-					if (it != preprocessorDefinitions.end()) {
+					if (FindSymbol(tokens[i+2])) {
 						val = "1";
 					}
 					tokens.erase(tokens.begin() + i + 1, tokens.begin() + i + 4);
@@ -1509,8 +1544,7 @@ void LexerCPP::EvaluateTokens(std::vector<std::string> &tokens, const SymbolTabl
 				}
 			} else {
 				// defined <identifier>
-				SymbolTable::const_iterator it = preprocessorDefinitions.find(tokens[i+1]);
-				if (it != preprocessorDefinitions.end()) {
+				if (FindSymbol(tokens[i+1])) {
 					val = "1";
 				}
 				tokens.erase(tokens.begin() + i + 1, tokens.begin() + i + 2);
@@ -1527,14 +1561,14 @@ void LexerCPP::EvaluateTokens(std::vector<std::string> &tokens, const SymbolTabl
 	for (size_t i = 0; (i<tokens.size()) && (iterations < maxIterations);) {
 		iterations++;
 		if (setWordStart.Contains(static_cast<unsigned char>(tokens[i][0]))) {
-			SymbolTable::const_iterator it = preprocessorDefinitions.find(tokens[i]);
-			if (it != preprocessorDefinitions.end()) {
+			const SymbolValue *symbol = FindSymbol(tokens[i]);
+			if (symbol) {
 				// Tokenize value
-				std::vector<std::string> macroTokens = Tokenize(it->second.value);
-				if (it->second.IsMacro()) {
+				std::vector<std::string> macroTokens = Tokenize(symbol->value);
+				if (symbol->IsMacro()) {
 					if ((i + 1 < tokens.size()) && (tokens.at(i + 1) == "(")) {
 						// Create map of argument name to value
-						std::vector<std::string> argumentNames = StringSplit(it->second.arguments, ',');
+						std::vector<std::string> argumentNames = StringSplit(symbol->arguments, ',');
 						std::map<std::string, std::string> arguments;
 						size_t arg = 0;
 						size_t tok = i+2;
@@ -1588,7 +1622,7 @@ void LexerCPP::EvaluateTokens(std::vector<std::string> &tokens, const SymbolTabl
 	BracketPair bracketPair = FindBracketPair(tokens);
 	while (bracketPair.itBracket != tokens.end()) {
 		std::vector<std::string> inBracket(bracketPair.itBracket + 1, bracketPair.itEndBracket);
-		EvaluateTokens(inBracket, preprocessorDefinitions);
+		EvaluateTokens(inBracket);
 
 		// The insertion is done before the removal because there were failures with the opposite approach
 		tokens.insert(bracketPair.itBracket, inBracket.begin(), inBracket.end());
@@ -1706,10 +1740,80 @@ std::vector<std::string> LexerCPP::Tokenize(const std::string &expr) const {
 	return tokens;
 }
 
-bool LexerCPP::EvaluateExpression(const std::string &expr, const SymbolTable &preprocessorDefinitions) {
+// Evaluate the most common conditions: a number, an undefined identifier, or a possibly
+// negated defined test, without tokenizing or allocating. Returns false for other
+// expressions which are left to EvaluateTokens.
+bool LexerCPP::EvaluateSimpleExpression(std::string_view expr, bool &result) const {
+	size_t pos = 0;
+	auto skipSpace = [&]() {
+		while ((pos < expr.length()) && IsSpaceOrTab(expr[pos]))
+			pos++;
+	};
+	auto word = [&]() {
+		const size_t start = pos;
+		while ((pos < expr.length()) && setWord.Contains(static_cast<unsigned char>(expr[pos])))
+			pos++;
+		return expr.substr(start, pos - start);
+	};
+	skipSpace();
+	bool negate = false;
+	if ((pos < expr.length()) && (expr[pos] == '!')) {
+		if ((pos + 1 < expr.length()) && setRelOp.Contains(static_cast<unsigned char>(expr[pos + 1])))
+			return false;
+		negate = true;
+		pos++;
+		skipSpace();
+	}
+	const std::string_view first = word();
+	if (first.empty())
+		return false;
+	skipSpace();
+	if (pos == expr.length()) {
+		// Lone word
+		if (negate)
+			return false;
+		if (!setWordStart.Contains(static_cast<unsigned char>(first[0]))) {
+			result = first != "0";
+			return true;
+		}
+		if (FindSymbol(first)) {
+			// Needs macro expansion
+			return false;
+		}
+		result = false;
+		return true;
+	}
+	if (first != "defined")
+		return false;
+	const bool bracketed = expr[pos] == '(';
+	if (bracketed) {
+		pos++;
+		skipSpace();
+	}
+	const std::string_view name = word();
+	if (name.empty())
+		return false;
+	skipSpace();
+	if (bracketed) {
+		if ((pos == expr.length()) || (expr[pos] != ')'))
+			return false;
+		pos++;
+		skipSpace();
+	}
+	if (pos != expr.length())
+		return false;
+	result = (FindSymbol(name) != nullptr) != negate;
+	return true;
+}
+
+bool LexerCPP::EvaluateExpression(const std::string &expr) {
+	bool result = false;
+	if (EvaluateSimpleExpression(expr, result))
+		return result;
+
 	std::vector<std::string> tokens = Tokenize(expr);
 
-	EvaluateTokens(tokens, preprocessorDefinitions);
+	EvaluateTokens(tokens);
 
 	// "0" or "" -> false else true
 	const bool isFalse = tokens.empty() ||
@@ -235,7 +235,7 @@ void ColouriseCamlDoc(
 						baseC = "x";
 					}
 					// ... change to specified base AS REQUIRED
-					if (strchr(baseC, sc.chNext))
+					if (sc.chNext && IsASCII(sc.chNext) && strchr(baseC, sc.chNext))
 						chBase = baseT[tolower(sc.chNext) - 'a'], sc.Forward();
 				}
 			} else if (!isSML && sc.Match('\''))	// (Caml char literal?)
@@ -12,6 +12,8 @@
 #include <assert.h>
 #include <ctype.h>
 
+#include <algorithm>
+
 #include "ILexer.h"
 #include "Scintilla.h"
 #include "SciLexer.h"
@@ -25,137 +27,162 @@
 
 using namespace Scintilla;
 
-static inline bool AtEOL(Accessor &styler, Sci_PositionU i) {
-	return (styler[i] == '\n') ||
-	       ((styler[i] == '\r') && (styler.SafeGetCharAt(i + 1) != '\n'));
-}
-
 #define DIFF_BUFFER_START_SIZE 16
-// Note that ColouriseDiffLine analyzes only the first DIFF_BUFFER_START_SIZE
+// Note that DiffLineStyle analyzes only the first DIFF_BUFFER_START_SIZE
 // characters of each line to classify the line.
 
-static void ColouriseDiffLine(char *lineBuffer, Sci_Position endLine, Accessor &styler) {
+// The line state of each line holds the number of lines added and removed
+// since the start of its file so that the totals for a file can be read from
+// its last line. Each count stops at diffCountMask.
+enum {
+	diffCountMask = 0x7FFF,
+	diffRemovedShift = 15
+};
+
+static int DiffLineStyle(const char *lineBuffer) {
 	// It is needed to remember the current state to recognize starting
 	// comment lines before the first "diff " or "--- ". If a real
 	// difference starts then each line starting with ' ' is a whitespace
 	// otherwise it is considered a comment (Only in..., Binary file...)
 	if (0 == strncmp(lineBuffer, "diff ", 5)) {
-		styler.ColourTo(endLine, SCE_DIFF_COMMAND);
+		return SCE_DIFF_COMMAND;
 	} else if (0 == strncmp(lineBuffer, "Index: ", 7)) {  // For subversion's diff
-		styler.ColourTo(endLine, SCE_DIFF_COMMAND);
+		return SCE_DIFF_COMMAND;
 	} else if (0 == strncmp(lineBuffer, "---", 3) && lineBuffer[3] != '-') {
 		// In a context diff, --- appears in both the header and the position markers
 		if (lineBuffer[3] == ' ' && atoi(lineBuffer + 4) && !strchr(lineBuffer, '/'))
-			styler.ColourTo(endLine, SCE_DIFF_POSITION);
+			return SCE_DIFF_POSITION;
 		else if (lineBuffer[3] == '\r' || lineBuffer[3] == '\n')
-			styler.ColourTo(endLine, SCE_DIFF_POSITION);
+			return SCE_DIFF_POSITION;
 		else if (lineBuffer[3] == ' ')
-			styler.ColourTo(endLine, SCE_DIFF_HEADER);
+			return SCE_DIFF_HEADER;
 		else
-			styler.ColourTo(endLine, SCE_DIFF_DELETED);
+			return SCE_DIFF_DELETED;
 	} else if (0 == strncmp(lineBuffer, "+++ ", 4)) {
 		// I don't know of any diff where "+++ " is a position marker, but for
 		// consistency, do the same as with "--- " and "*** ".
 		if (atoi(lineBuffer+4) && !strchr(lineBuffer, '/'))
-			styler.ColourTo(endLine, SCE_DIFF_POSITION);
+			return SCE_DIFF_POSITION;
 		else
-			styler.ColourTo(endLine, SCE_DIFF_HEADER);
+			return SCE_DIFF_HEADER;
 	} else if (0 == strncmp(lineBuffer, "====", 4)) {  // For p4's diff
-		styler.ColourTo(endLine, SCE_DIFF_HEADER);
+		return SCE_DIFF_HEADER;
 	} else if (0 == strncmp(lineBuffer, "***", 3)) {
 		// In a context diff, *** appears in both the header and the position markers.
 		// Also ******** is a chunk header, but here it's treated as part of the
 		// position marker since there is no separate style for a chunk header.
 		if (lineBuffer[3] == ' ' && atoi(lineBuffer+4) && !strchr(lineBuffer, '/'))
-			styler.ColourTo(endLine, SCE_DIFF_POSITION);
+			return SCE_DIFF_POSITION;
 		else if (lineBuffer[3] == '*')
-			styler.ColourTo(endLine, SCE_DIFF_POSITION);
+			return SCE_DIFF_POSITION;
 		else
-			styler.ColourTo(endLine, SCE_DIFF_HEADER);
+			return SCE_DIFF_HEADER;
 	} else if (0 == strncmp(lineBuffer, "? ", 2)) {    // For difflib
-		styler.ColourTo(endLine, SCE_DIFF_HEADER);
+		return SCE_DIFF_HEADER;
 	} else if (lineBuffer[0] == '@') {
-		styler.ColourTo(endLine, SCE_DIFF_POSITION);
+		return SCE_DIFF_POSITION;
 	} else if (lineBuffer[0] >= '0' && lineBuffer[0] <= '9') {
-		styler.ColourTo(endLine, SCE_DIFF_POSITION);
+		return SCE_DIFF_POSITION;
 	} else if (0 == strncmp(lineBuffer, "++", 2)) {
-		styler.ColourTo(endLine, SCE_DIFF_PATCH_ADD);
+		return SCE_DIFF_PATCH_ADD;
 	} else if (0 == strncmp(lineBuffer, "+-", 2)) {
-		styler.ColourTo(endLine, SCE_DIFF_PATCH_DELETE);
+		return SCE_DIFF_PATCH_DELETE;
 	} else if (0 == strncmp(lineBuffer, "-+", 2)) {
-		styler.ColourTo(endLine, SCE_DIFF_REMOVED_PATCH_ADD);
+		return SCE_DIFF_REMOVED_PATCH_ADD;
 	} else if (0 == strncmp(lineBuffer, "--", 2)) {
-		styler.ColourTo(endLine, SCE_DIFF_REMOVED_PATCH_DELETE);
+		return SCE_DIFF_REMOVED_PATCH_DELETE;
 	} else if (lineBuffer[0] == '-' || lineBuffer[0] == '<') {
-		styler.ColourTo(endLine, SCE_DIFF_DELETED);
+		return SCE_DIFF_DELETED;
 	} else if (lineBuffer[0] == '+' || lineBuffer[0] == '>') {
-		styler.ColourTo(endLine, SCE_DIFF_ADDED);
+		return SCE_DIFF_ADDED;
 	} else if (lineBuffer[0] == '!') {
-		styler.ColourTo(endLine, SCE_DIFF_CHANGED);
+		return SCE_DIFF_CHANGED;
 	} else if (lineBuffer[0] != ' ') {
-		styler.ColourTo(endLine, SCE_DIFF_COMMENT);
+		return SCE_DIFF_COMMENT;
 	} else {
-		styler.ColourTo(endLine, SCE_DIFF_DEFAULT);
+		return SCE_DIFF_DEFAULT;
+	}
+}
+
+static int CountDiffLine(int counts, int style, int stylePrev) {
+	int added = counts & diffCountMask;
+	int removed = (counts >> diffRemovedShift) & diffCountMask;
+	switch (style) {
+	case SCE_DIFF_COMMAND:
+		return 0;
+	case SCE_DIFF_HEADER:
+		// A file without a command line starts at its first header line
+		if (stylePrev != SCE_DIFF_COMMAND && stylePrev != SCE_DIFF_HEADER)
+			return 0;
+		break;
+	case SCE_DIFF_ADDED:
+	case SCE_DIFF_PATCH_ADD:
+	case SCE_DIFF_PATCH_DELETE:
+		added = std::min(added + 1, static_cast<int>(diffCountMask));
+		break;
+	case SCE_DIFF_DELETED:
+	case SCE_DIFF_REMOVED_PATCH_ADD:
+	case SCE_DIFF_REMOVED_PATCH_DELETE:
+		removed = std::min(removed + 1, static_cast<int>(diffCountMask));
+		break;
 	}
+	return added | (removed << diffRemovedShift);
 }
 
+// Lines are classified from their first few characters so each line is visited
+// once, setting its style, line state and, when folding, its fold level.
 static void ColouriseDiffDoc(Sci_PositionU startPos, Sci_Position length, int, WordList *[], Accessor &styler) {
+	const bool fold = styler.GetPropertyInt("fold") != 0;
 	char lineBuffer[DIFF_BUFFER_START_SIZE] = "";
 	styler.StartAt(startPos);
 	styler.StartSegment(startPos);
-	Sci_PositionU linePos = 0;
-	for (Sci_PositionU i = startPos; i < startPos + length; i++) {
-		if (AtEOL(styler, i)) {
-			if (linePos < DIFF_BUFFER_START_SIZE) {
-				lineBuffer[linePos] = 0;
-			}
-			ColouriseDiffLine(lineBuffer, i, styler);
-			linePos = 0;
-		} else if (linePos < DIFF_BUFFER_START_SIZE - 1) {
-			lineBuffer[linePos++] = styler[i];
-		} else if (linePos == DIFF_BUFFER_START_SIZE - 1) {
-			lineBuffer[linePos++] = 0;
-		}
-	}
-	if (linePos > 0) {	// Last line does not have ending characters
-		if (linePos < DIFF_BUFFER_START_SIZE) {
-			lineBuffer[linePos] = 0;
-		}
-		ColouriseDiffLine(lineBuffer, startPos + length - 1, styler);
-	}
-}
+	const Sci_Position endPos = startPos + length;
+	const Sci_Position lineLast = styler.GetLine(styler.Length());
+	Sci_Position lineCurrent = styler.GetLine(startPos);
+	int stylePrev = (startPos > 0) ? styler.StyleAt(startPos - 1) : SCE_DIFF_DEFAULT;
+	int counts = (lineCurrent > 0) ? styler.GetLineState(lineCurrent - 1) : 0;
+	int prevLevel = (lineCurrent > 0) ? styler.LevelAt(lineCurrent - 1) : SC_FOLDLEVELBASE;
+	Sci_Position lineStart = startPos;
+	while (lineStart < endPos) {
+		const Sci_Position lineStartNext = styler.LineStart(lineCurrent + 1);
+		const Sci_Position lineEnd = std::min(lineStartNext, endPos);
+		// The line end character is left out of the classified text
+		const bool atEOL = (lineEnd == lineStartNext) && (lineCurrent < lineLast);
+		const Sci_Position textEnd = atEOL ? lineEnd - 1 : lineEnd;
+		styler.GetRange(lineStart, std::min(textEnd, lineStart + DIFF_BUFFER_START_SIZE - 1), lineBuffer);
+		const int style = DiffLineStyle(lineBuffer);
+		styler.ColourTo(lineEnd - 1, style);
+		counts = CountDiffLine(counts, style, stylePrev);
+		styler.SetLineState(lineCurrent, counts);
 
-static void FoldDiffDoc(Sci_PositionU startPos, Sci_Position length, int, WordList *[], Accessor &styler) {
-	Sci_Position curLine = styler.GetLine(startPos);
-	Sci_Position curLineStart = styler.LineStart(curLine);
-	int prevLevel = curLine > 0 ? styler.LevelAt(curLine - 1) : SC_FOLDLEVELBASE;
-	int nextLevel;
-
-	do {
-		const int lineType = styler.StyleAt(curLineStart);
-		if (lineType == SCE_DIFF_COMMAND)
-			nextLevel = SC_FOLDLEVELBASE | SC_FOLDLEVELHEADERFLAG;
-		else if (lineType == SCE_DIFF_HEADER)
-			nextLevel = (SC_FOLDLEVELBASE + 1) | SC_FOLDLEVELHEADERFLAG;
-		else if (lineType == SCE_DIFF_POSITION && styler[curLineStart] != '-')
-			nextLevel = (SC_FOLDLEVELBASE + 2) | SC_FOLDLEVELHEADERFLAG;
-		else if (prevLevel & SC_FOLDLEVELHEADERFLAG)
-			nextLevel = (prevLevel & SC_FOLDLEVELNUMBERMASK) + 1;
-		else
-			nextLevel = prevLevel;
+		if (fold) {
+			int nextLevel;
+			if (style == SCE_DIFF_COMMAND)
+				nextLevel = SC_FOLDLEVELBASE | SC_FOLDLEVELHEADERFLAG;
+			else if (style == SCE_DIFF_HEADER)
+				nextLevel = (SC_FOLDLEVELBASE + 1) | SC_FOLDLEVELHEADERFLAG;
+			else if (style == SCE_DIFF_POSITION && lineBuffer[0] != '-')
+				nextLevel = (SC_FOLDLEVELBASE + 2) | SC_FOLDLEVELHEADERFLAG;
+			else if (prevLevel & SC_FOLDLEVELHEADERFLAG)
+				nextLevel = (prevLevel & SC_FOLDLEVELNUMBERMASK) + 1;
+			else
+				nextLevel = prevLevel;
 
-		if ((nextLevel & SC_FOLDLEVELHEADERFLAG) && (nextLevel == prevLevel))
-			styler.SetLevel(curLine-1, prevLevel & ~SC_FOLDLEVELHEADERFLAG);
+			if ((nextLevel & SC_FOLDLEVELHEADERFLAG) && (nextLevel == prevLevel))
+				styler.SetLevel(lineCurrent-1, prevLevel & ~SC_FOLDLEVELHEADERFLAG);
 
-		styler.SetLevel(curLine, nextLevel);
-		prevLevel = nextLevel;
+			styler.SetLevel(lineCurrent, nextLevel);
+			prevLevel = nextLevel;
+		}
 
-		curLineStart = styler.LineStart(++curLine);
-	} while (static_cast<Sci_Position>(startPos)+length > curLineStart);
+		stylePrev = style;
+		lineStart = lineEnd;
+		lineCurrent++;
+	}
 }
 
 static const char *const emptyWordListDesc[] = {
 	0
 };
 
-LexerModule lmDiff(SCLEX_DIFF, ColouriseDiffDoc, "diff", FoldDiffDoc, emptyWordListDesc);
+LexerModule lmDiff(SCLEX_DIFF, ColouriseDiffDoc, "diff", 0, emptyWordListDesc);
@@ -12,6 +12,8 @@
 #include <assert.h>
 #include <ctype.h>
 
+#include <algorithm>
+
 #include "ILexer.h"
 #include "Scintilla.h"
 #include "SciLexer.h"
@@ -41,12 +43,32 @@ static bool IsAlphabetic(int ch) {
 	return IsASCII(ch) && isalpha(ch);
 }
 
-static inline bool AtEOL(Accessor &styler, Sci_PositionU i) {
-	return (styler[i] == '\n') ||
-	       ((styler[i] == '\r') && (styler.SafeGetCharAt(i + 1) != '\n'));
+// The location formats below can only start at a ':' not followed by a path separator
+// or space, at a '(' followed by a line number, or at a tab. Finding these with
+// memchr, which is much faster than examining each character, rejects most lines.
+static bool MayHaveLocation(const char *lineBuffer, Sci_PositionU lengthLine) {
+	const char *end = lineBuffer + lengthLine;
+	if (memchr(lineBuffer, '\t', lengthLine)) {
+		return true;
+	}
+	for (const char *s = lineBuffer; (s = static_cast<const char *>(memchr(s, ':', end - s))) != nullptr; s++) {
+		const char chNext = (s + 1 < end) ? s[1] : ' ';
+		if ((chNext != '\\') && (chNext != '/') && (chNext != ' ')) {
+			return true;
+		}
+	}
+	for (const char *s = lineBuffer; (s = static_cast<const char *>(memchr(s, '(', end - s))) != nullptr; s++) {
+		const char chNext = (s + 1 < end) ? s[1] : ' ';
+		if (Is1To9(chNext)) {
+			return true;
+		}
+	}
+	return false;
 }
 
 static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLine, Sci_Position &startValue) {
+	// The Python, PHP, Lua 4 and perl formats all contain "line " so look for it once
+	const bool hasLine = strstr(lineBuffer, "line ") != nullptr;
 	if (lineBuffer[0] == '>') {
 		// Command or return status
 		return SCE_ERR_CMD;
@@ -73,9 +95,9 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 	} else if (strstart(lineBuffer, "fortcom:")) {
 		// Intel Fortran Compiler v8.0 error/warning message
 		return SCE_ERR_IFORT;
-	} else if (strstr(lineBuffer, "File \"") && strstr(lineBuffer, ", line ")) {
+	} else if (hasLine && strstr(lineBuffer, "File \"") && strstr(lineBuffer, ", line ")) {
 		return SCE_ERR_PYTHON;
-	} else if (strstr(lineBuffer, " in ") && strstr(lineBuffer, " on line ")) {
+	} else if (hasLine && strstr(lineBuffer, " in ") && strstr(lineBuffer, " on line ")) {
 		return SCE_ERR_PHP;
 	} else if ((strstart(lineBuffer, "Error ") ||
 	            strstart(lineBuffer, "Warning ")) &&
@@ -90,13 +112,13 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 	} else if (strstart(lineBuffer, "Warning ")) {
 		// Borland warning message
 		return SCE_ERR_BORLAND;
-	} else if (strstr(lineBuffer, "at line ") &&
+	} else if (hasLine && strstr(lineBuffer, "at line ") &&
 	        (strstr(lineBuffer, "at line ") < (lineBuffer + lengthLine)) &&
 	           strstr(lineBuffer, "file ") &&
 	           (strstr(lineBuffer, "file ") < (lineBuffer + lengthLine))) {
 		// Lua 4 error message
 		return SCE_ERR_LUA;
-	} else if (strstr(lineBuffer, " at ") &&
+	} else if (hasLine && strstr(lineBuffer, " at ") &&
 	        (strstr(lineBuffer, " at ") < (lineBuffer + lengthLine)) &&
 	           strstr(lineBuffer, " line ") &&
 	           (strstr(lineBuffer, " line ") < (lineBuffer + lengthLine)) &&
@@ -130,6 +152,14 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 		// Microsoft linker warning:
 		// {<object> : } warning LNK9999
 		return SCE_ERR_MS;
+	} else if (!MayHaveLocation(lineBuffer, lengthLine)) {
+		// Any ':' is followed by a space so this is just the check at the end of the state machine
+		if (strstr(lineBuffer, ": warning C")) {
+			// Microsoft warning without line number
+			// <filename>: warning C9999
+			return SCE_ERR_MS;
+		}
+		return SCE_ERR_DEFAULT;
 	} else {
 		// Look for one of the following formats:
 		// GCC: <filename>:<line>:<message>
@@ -358,7 +388,6 @@ static void ColouriseErrorListDoc(Sci_PositionU startPos, Sci_Position length, i
 	char lineBuffer[10000];
 	styler.StartAt(startPos);
 	styler.StartSegment(startPos);
-	Sci_PositionU linePos = 0;
 
 	// property lexer.errorlist.value.separate
 	//	For lines in the output pane that are matches from Find in Files or GCC-style
@@ -371,18 +400,18 @@ static void ColouriseErrorListDoc(Sci_PositionU startPos, Sci_Position length, i
 	//	Set to 1 to interpret escape sequences.
 	const bool escapeSequences = styler.GetPropertyInt("lexer.errorlist.escape.sequences") != 0;
 
-	for (Sci_PositionU i = startPos; i < startPos + length; i++) {
-		lineBuffer[linePos++] = styler[i];
-		if (AtEOL(styler, i) || (linePos >= sizeof(lineBuffer) - 1)) {
-			// End of line (or of line buffer) met, colourise it
-			lineBuffer[linePos] = '\0';
-			ColouriseErrorListLine(lineBuffer, linePos, i, styler, valueSeparate, escapeSequences);
-			linePos = 0;
-		}
-	}
-	if (linePos > 0) {	// Last line does not have ending characters
-		lineBuffer[linePos] = '\0';
-		ColouriseErrorListLine(lineBuffer, linePos, startPos + length - 1, styler, valueSeparate, escapeSequences);
+	// Copy each line (or piece of line that fills the line buffer) in one call
+	const Sci_PositionU endPos = startPos + length;
+	Sci_Position line = styler.GetLine(startPos);
+	Sci_PositionU linePos = startPos;
+	while (linePos < endPos) {
+		const Sci_PositionU lineEnd = std::min<Sci_PositionU>(styler.LineStart(line + 1), endPos);
+		const Sci_PositionU pieceEnd = std::min<Sci_PositionU>(lineEnd, linePos + sizeof(lineBuffer) - 1);
+		styler.GetRange(linePos, pieceEnd, lineBuffer);
+		ColouriseErrorListLine(lineBuffer, pieceEnd - linePos, pieceEnd - 1, styler, valueSeparate, escapeSequences);
+		linePos = pieceEnd;
+		if (linePos == lineEnd)
+			line++;
 	}
 }
 
@@ -12,8 +12,10 @@
 #include <assert.h>
 #include <ctype.h>
 #include <string>
+#include <vector>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -25,10 +27,16 @@
 #include "CharacterSet.h"
 #include "LexerModule.h"
 #include "OptionSet.h"
+#include "SparseState.h"
 #include "DefaultLexer.h"
 
 using namespace Scintilla;
 
+// Lexers that client-side scripts can be delegated to
+extern LexerModule lmCPP;
+extern LexerModule lmPython;
+extern LexerModule lmVBScript;
+
 namespace {
 
 #define SCE_HA_JS (SCE_HJA_START - SCE_HJ_START)
@@ -549,6 +557,357 @@ Sci_Position FindPhpStringDelimiter(std::string &phpStringDelimiter, Sci_Positio
 	return j - 1;
 }
 
+// Client-side scripts can be styled by the lexers for their languages. The styles
+// of those lexers are mapped onto the HTML script styles and back.
+struct ScriptStyles {
+	const LexerModule *module;
+	const int *htmlStyles;
+	size_t lengthHTML;
+	int firstHTML;
+	const int *scriptStyles;
+	size_t lengthScript;
+	int StyleHTML(int style) const noexcept {
+		style &= 0x3F;	// Drop the inactive flag of the cpp lexer
+		return htmlStyles[(static_cast<size_t>(style) < lengthHTML) ? style : 0];
+	}
+	int StyleScript(int style) const noexcept {
+		const size_t index = style - firstHTML;
+		return (index < lengthScript) ? scriptStyles[index] : scriptStyles[0];
+	}
+};
+
+const int htmlStylesCPP[] = {
+	SCE_HJ_DEFAULT,	// SCE_C_DEFAULT
+	SCE_HJ_COMMENT,
+	SCE_HJ_COMMENTLINE,
+	SCE_HJ_COMMENTDOC,
+	SCE_HJ_NUMBER,
+	SCE_HJ_KEYWORD,	// SCE_C_WORD
+	SCE_HJ_DOUBLESTRING,
+	SCE_HJ_SINGLESTRING,	// SCE_C_CHARACTER
+	SCE_HJ_WORD,	// SCE_C_UUID
+	SCE_HJ_DEFAULT,	// SCE_C_PREPROCESSOR
+	SCE_HJ_SYMBOLS,
+	SCE_HJ_WORD,	// SCE_C_IDENTIFIER
+	SCE_HJ_STRINGEOL,
+	SCE_HJ_DOUBLESTRING,	// SCE_C_VERBATIM
+	SCE_HJ_REGEX,
+	SCE_HJ_COMMENTLINE,	// SCE_C_COMMENTLINEDOC
+	SCE_HJ_KEYWORD,	// SCE_C_WORD2
+	SCE_HJ_COMMENTDOC,	// SCE_C_COMMENTDOCKEYWORD
+	SCE_HJ_COMMENTDOC,	// SCE_C_COMMENTDOCKEYWORDERROR
+	SCE_HJ_WORD,	// SCE_C_GLOBALCLASS
+	SCE_HJ_DOUBLESTRING,	// SCE_C_STRINGRAW, template literals
+	SCE_HJ_DOUBLESTRING,	// SCE_C_TRIPLEVERBATIM
+	SCE_HJ_DOUBLESTRING,	// SCE_C_HASHQUOTEDSTRING
+	SCE_HJ_COMMENT,	// SCE_C_PREPROCESSORCOMMENT
+	SCE_HJ_COMMENTDOC,	// SCE_C_PREPROCESSORCOMMENTDOC
+	SCE_HJ_NUMBER,	// SCE_C_USERLITERAL
+	SCE_HJ_COMMENT,	// SCE_C_TASKMARKER
+	SCE_HJ_DOUBLESTRING,	// SCE_C_ESCAPESEQUENCE
+};
+
+const int cppStylesHTML[] = {
+	SCE_C_DEFAULT,	// SCE_HJ_START
+	SCE_C_DEFAULT,
+	SCE_C_COMMENT,
+	SCE_C_COMMENTLINE,
+	SCE_C_COMMENTDOC,
+	SCE_C_NUMBER,
+	SCE_C_IDENTIFIER,	// SCE_HJ_WORD
+	SCE_C_WORD,	// SCE_HJ_KEYWORD
+	SCE_C_STRING,
+	SCE_C_CHARACTER,	// SCE_HJ_SINGLESTRING
+	SCE_C_OPERATOR,
+	SCE_C_STRINGEOL,
+	SCE_C_REGEX,
+};
+
+const int htmlStylesVB[] = {
+	SCE_HB_DEFAULT,	// SCE_B_DEFAULT
+	SCE_HB_COMMENTLINE,
+	SCE_HB_NUMBER,
+	SCE_HB_WORD,	// SCE_B_KEYWORD
+	SCE_HB_STRING,
+	SCE_HB_DEFAULT,	// SCE_B_PREPROCESSOR
+	SCE_HB_DEFAULT,	// SCE_B_OPERATOR, as the inline lexer styles operators
+	SCE_HB_IDENTIFIER,
+	SCE_HB_NUMBER,	// SCE_B_DATE
+	SCE_HB_STRINGEOL,
+	SCE_HB_WORD,	// SCE_B_KEYWORD2
+	SCE_HB_WORD,	// SCE_B_KEYWORD3
+	SCE_HB_WORD,	// SCE_B_KEYWORD4
+	SCE_HB_IDENTIFIER,	// SCE_B_CONSTANT
+	SCE_HB_DEFAULT,	// SCE_B_ASM
+	SCE_HB_IDENTIFIER,	// SCE_B_LABEL
+	SCE_HB_DEFAULT,	// SCE_B_ERROR
+	SCE_HB_NUMBER,	// SCE_B_HEXNUMBER
+	SCE_HB_NUMBER,	// SCE_B_BINNUMBER
+	SCE_HB_COMMENTLINE,	// SCE_B_COMMENTBLOCK
+	SCE_HB_COMMENTLINE,	// SCE_B_DOCLINE
+	SCE_HB_COMMENTLINE,	// SCE_B_DOCBLOCK
+	SCE_HB_COMMENTLINE,	// SCE_B_DOCKEYWORD
+};
+
+const int vbStylesHTML[] = {
+	SCE_B_DEFAULT,	// SCE_HB_START
+	SCE_B_DEFAULT,
+	SCE_B_COMMENT,
+	SCE_B_NUMBER,
+	SCE_B_KEYWORD,
+	SCE_B_STRING,
+	SCE_B_IDENTIFIER,
+	SCE_B_STRINGEOL,
+};
+
+const int htmlStylesPython[] = {
+	SCE_HP_DEFAULT,	// SCE_P_DEFAULT
+	SCE_HP_COMMENTLINE,
+	SCE_HP_NUMBER,
+	SCE_HP_STRING,
+	SCE_HP_CHARACTER,
+	SCE_HP_WORD,
+	SCE_HP_TRIPLE,
+	SCE_HP_TRIPLEDOUBLE,
+	SCE_HP_CLASSNAME,
+	SCE_HP_DEFNAME,
+	SCE_HP_OPERATOR,
+	SCE_HP_IDENTIFIER,
+	SCE_HP_COMMENTLINE,	// SCE_P_COMMENTBLOCK
+	SCE_HP_STRING,	// SCE_P_STRINGEOL
+	SCE_HP_IDENTIFIER,	// SCE_P_WORD2
+	SCE_HP_IDENTIFIER,	// SCE_P_DECORATOR
+	SCE_HP_STRING,	// SCE_P_FSTRING
+	SCE_HP_CHARACTER,	// SCE_P_FCHARACTER
+	SCE_HP_TRIPLE,	// SCE_P_FTRIPLE
+	SCE_HP_TRIPLEDOUBLE,	// SCE_P_FTRIPLEDOUBLE
+};
+
+const int pythonStylesHTML[] = {
+	SCE_P_DEFAULT,	// SCE_HP_START
+	SCE_P_DEFAULT,
+	SCE_P_COMMENTLINE,
+	SCE_P_NUMBER,
+	SCE_P_STRING,
+	SCE_P_CHARACTER,
+	SCE_P_WORD,
+	SCE_P_TRIPLE,
+	SCE_P_TRIPLEDOUBLE,
+	SCE_P_CLASSNAME,
+	SCE_P_DEFNAME,
+	SCE_P_OPERATOR,
+	SCE_P_IDENTIFIER,
+};
+
+const ScriptStyles scriptStylesJS = {
+	&lmCPP, htmlStylesCPP, std::size(htmlStylesCPP), SCE_HJ_START, cppStylesHTML, std::size(cppStylesHTML)
+};
+const ScriptStyles scriptStylesVBS = {
+	&lmVBScript, htmlStylesVB, std::size(htmlStylesVB), SCE_HB_START, vbStylesHTML, std::size(vbStylesHTML)
+};
+const ScriptStyles scriptStylesPython = {
+	&lmPython, htmlStylesPython, std::size(htmlStylesPython), SCE_HP_START, pythonStylesHTML, std::size(pythonStylesHTML)
+};
+
+const ScriptStyles *StylesForScript(script_type scriptLanguage) noexcept {
+	switch (scriptLanguage) {
+	case eScriptJS:
+		return &scriptStylesJS;
+	case eScriptVBS:
+		return &scriptStylesVBS;
+	case eScriptPython:
+		return &scriptStylesPython;
+	default:
+		return nullptr;
+	}
+}
+
+// A range of a client-side script styled by its own lexer: where it starts and the
+// script lexer's style it starts in
+struct ScriptRegion {
+	Sci_Position start = -1;
+	int startStyle = 0;
+	ScriptRegion() noexcept = default;
+	ScriptRegion(Sci_Position start_, int startStyle_) noexcept : start(start_), startStyle(startStyle_) {
+	}
+	bool operator==(const ScriptRegion &other) const noexcept {
+		return (start == other.start) && (startStyle == other.startStyle);
+	}
+};
+
+// The script region containing the end of a line and the script lexer's own style there,
+// so lexing can continue inside a region without mapping styles back.
+// The region's start is kept as its distance back from the start of the next line since
+// edits after that line move the line without changing the record.
+struct ScriptLineEnd {
+	Sci_Position back = -1;
+	int startStyle = 0;
+	int style = 0;
+	ScriptLineEnd() noexcept = default;
+	ScriptLineEnd(ScriptRegion region, Sci_Position nextLineStart, int style_) noexcept :
+		back(nextLineStart - region.start), startStyle(region.startStyle), style(style_) {
+	}
+	bool InRegion() const noexcept {
+		return back >= 0;
+	}
+	ScriptRegion Region(Sci_Position nextLineStart) const noexcept {
+		return ScriptRegion(nextLineStart - back, startStyle);
+	}
+	bool operator==(const ScriptLineEnd &other) const noexcept {
+		return (back == other.back) && (startStyle == other.startStyle) && (style == other.style);
+	}
+	bool operator!=(const ScriptLineEnd &other) const noexcept {
+		return !(*this == other);
+	}
+};
+
+// Whether a region of scriptLanguage can start at position: at the start of the document or
+// after text the HTML lexer styled itself, such as the script's start tag or a line comment
+// it finished inline
+bool ScriptRegionCanStart(LexAccessor &styler, Sci_Position position, script_type scriptLanguage) {
+	if (position <= 0)
+		return position == 0;
+	const int stylePrev = styler.StyleAt(position - 1);
+	return (ScriptOfState(stylePrev) != scriptLanguage) ||
+		(stylePrev == SCE_HJ_START) || (stylePrev == SCE_HB_START) || (stylePrev == SCE_HP_START) ||
+		(stylePrev == SCE_HJ_COMMENTLINE) || (stylePrev == SCE_HB_COMMENTLINE) || (stylePrev == SCE_HP_COMMENTLINE);
+}
+
+// Find the start of the region of scriptLanguage containing position from the styles before it
+Sci_Position ScriptRegionStart(LexAccessor &styler, Sci_Position position, script_type scriptLanguage) {
+	while (!ScriptRegionCanStart(styler, position, scriptLanguage))
+		position--;
+	return position;
+}
+
+// The document as seen by a script lexer: positions are relative to the start of the
+// script region while lines keep the document's numbering, so the line based state of
+// the script lexers stays valid from one region to the next.
+// Styles are mapped to HTML styles when written and back when read. The styles written
+// from lexStart on are also kept unmapped for the HTML lexer.
+class ScriptDocument : public IDocument {
+	IDocument *pAccess;
+	const Sci_Position start;
+	const ScriptStyles &scriptStyles;
+	SparseState<ScriptLineEnd> &lineEnds;
+	const Sci_Position lexStart;
+	std::vector<char> &styles;
+	Sci_Position stylingPosition = 0;
+	Sci_Position DocumentLine(Sci_Position position) const {
+		return pAccess->LineFromPosition(position + start);
+	}
+	void Record(Sci_Position position, char style) {
+		const size_t index = position + start - lexStart;
+		if (index < styles.size())
+			styles[index] = style;
+	}
+public:
+	ScriptDocument(IDocument *pAccess_, Sci_Position start_, const ScriptStyles &scriptStyles_,
+		SparseState<ScriptLineEnd> &lineEnds_, Sci_Position lexStart_, std::vector<char> &styles_) :
+		pAccess(pAccess_), start(start_), scriptStyles(scriptStyles_), lineEnds(lineEnds_),
+		lexStart(lexStart_), styles(styles_) {
+	}
+	int SCI_METHOD Version() const override {
+		return dvRelease4;
+	}
+	void SCI_METHOD SetErrorStatus(int status) override {
+		pAccess->SetErrorStatus(status);
+	}
+	Sci_Position SCI_METHOD Length() const override {
+		return pAccess->Length() - start;
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const override {
+		pAccess->GetCharRange(buffer, position + start, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(Sci_Position position) const override {
+		if (position < 0 || position >= Length())
+			return 0;
+		if (position + start >= lexStart) {
+			// Written during this pass
+			const size_t index = position + start - lexStart;
+			return (index < styles.size()) ? styles[index] : 0;
+		}
+		const Sci_Position line = DocumentLine(position);
+		const Sci_Position nextLineStart = pAccess->LineStart(line + 1);
+		if (nextLineStart == position + start + 1) {
+			const ScriptLineEnd lineEnd = lineEnds.ValueAt(line);
+			if (lineEnd.InRegion() && (lineEnd.Region(nextLineStart).start == start))
+				return static_cast<char>(lineEnd.style);
+		}
+		return static_cast<char>(scriptStyles.StyleScript(static_cast<unsigned char>(pAccess->StyleAt(position + start))));
+	}
+	Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const override {
+		return DocumentLine(position);
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Position line) const override {
+		return std::max<Sci_Position>(pAccess->LineStart(line) - start, 0);
+	}
+	int SCI_METHOD GetLevel(Sci_Position) const override {
+		return SC_FOLDLEVELBASE;
+	}
+	int SCI_METHOD SetLevel(Sci_Position, int) override {
+		// Folding is performed by the HTML lexer
+		return SC_FOLDLEVELBASE;
+	}
+	int SCI_METHOD GetLineState(Sci_Position) const override {
+		return 0;
+	}
+	int SCI_METHOD SetLineState(Sci_Position, int) override {
+		// The line states of the document belong to the HTML lexer
+		return 0;
+	}
+	void SCI_METHOD StartStyling(Sci_Position position) override {
+		stylingPosition = position;
+		pAccess->StartStyling(position + start);
+	}
+	bool SCI_METHOD SetStyleFor(Sci_Position length, char style) override {
+		for (Sci_Position i = 0; i < length; i++)
+			Record(stylingPosition + i, style);
+		stylingPosition += length;
+		return pAccess->SetStyleFor(length, static_cast<char>(scriptStyles.StyleHTML(static_cast<unsigned char>(style))));
+	}
+	bool SCI_METHOD SetStyles(Sci_Position length, const char *styles_) override {
+		std::vector<char> htmlStyles(length);
+		for (Sci_Position i = 0; i < length; i++) {
+			Record(stylingPosition + i, styles_[i]);
+			htmlStyles[i] = static_cast<char>(scriptStyles.StyleHTML(static_cast<unsigned char>(styles_[i])));
+		}
+		stylingPosition += length;
+		return pAccess->SetStyles(length, htmlStyles.data());
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) override {
+		pAccess->DecorationSetCurrentIndicator(indicator);
+	}
+	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override {
+		pAccess->DecorationFillRange(position + start, value, fillLength);
+	}
+	void SCI_METHOD ChangeLexerState(Sci_Position startChange, Sci_Position endChange) override {
+		pAccess->ChangeLexerState(startChange + start, endChange + start);
+	}
+	int SCI_METHOD CodePage() const override {
+		return pAccess->CodePage();
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char ch) const override {
+		return pAccess->IsDBCSLeadByte(ch);
+	}
+	const char *SCI_METHOD BufferPointer() override {
+		return pAccess->BufferPointer() + start;
+	}
+	int SCI_METHOD GetLineIndentation(Sci_Position line) override {
+		return pAccess->GetLineIndentation(line);
+	}
+	Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override {
+		return std::max<Sci_Position>(pAccess->LineEnd(line) - start, 0);
+	}
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const override {
+		const Sci_Position position = pAccess->GetRelativePosition(positionStart + start, characterOffset);
+		return (position < 0) ? position : position - start;
+	}
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const override {
+		return pAccess->GetCharacterAndWidth(position + start, pWidth);
+	}
+};
+
 // Options used for LexerHTML
 struct OptionsHTML {
 	int aspDefaultLanguage = eScriptJS;
@@ -562,6 +921,7 @@ struct OptionsHTML {
 	bool foldCompact = true;
 	bool foldComment = false;
 	bool foldHeredoc = false;
+	bool scriptLexers = false;
 	OptionsHTML() noexcept {
 	}
 };
@@ -606,6 +966,10 @@ struct OptionSetHTML : public OptionSet<OptionsHTML> {
 		DefineProperty("lexer.html.django", &OptionsHTML::isDjango,
 			"Set to 1 to enable the django template language.");
 
+		DefineProperty("lexer.html.script.lexers", &OptionsHTML::scriptLexers,
+			"Set to 1 to style client-side JavaScript, VBScript and Python scripts with the "
+			"cpp, vbscript and python lexers, using the HTML script styles.");
+
 		DefineProperty("fold", &OptionsHTML::fold);
 
 		DefineProperty("fold.html", &OptionsHTML::foldHTML,
@@ -833,6 +1197,15 @@ class LexerHTML : public DefaultLexer {
 	OptionsHTML options;
 	OptionSetHTML osHTML;
 	std::set<std::string> nonFoldingTags;
+	// Delimiter of the PHP string still open at the end of each line
+	SparseState<std::string> phpStringDelimiters;
+	// Lexers for client-side scripts, created when first used, and their keywords
+	ILexer4 *scriptLexers[eScriptPython + 1] = {};
+	std::string scriptKeywords[eScriptPython + 1];
+	SparseState<ScriptLineEnd> scriptLineEnds;
+	ILexer4 *ScriptLexer(script_type scriptLanguage);
+	Sci_Position LexScript(Sci_Position start, Sci_Position lengthDoc, script_type scriptLanguage,
+		ScriptRegion region, int initStyle, Accessor &styler, IDocument *pAccess, std::vector<char> &styles);
 public:
 	explicit LexerHTML(bool isXml_, bool isPHPScript_) :
 		DefaultLexer(isXml_ ? lexicalClassesHTML : lexicalClassesXML,
@@ -843,6 +1216,10 @@ public:
 		nonFoldingTags(std::begin(tagsThatDoNotFold), std::end(tagsThatDoNotFold)) {
 	}
 	~LexerHTML() override {
+		for (ILexer4 *lexer : scriptLexers) {
+			if (lexer)
+				lexer->Release();
+		}
 	}
 	void SCI_METHOD Release() override {
 		delete this;
@@ -913,9 +1290,63 @@ Sci_Position SCI_METHOD LexerHTML::WordListSet(int n, const char *wl) {
 			firstModification = 0;
 		}
 	}
+	// Sets 1 to 3 are the JavaScript, VBScript and Python keywords, numbered as script_type,
+	// which are also the keywords of the script lexers
+	if (n >= eScriptJS && n <= eScriptPython) {
+		scriptKeywords[n] = wl;
+		if (scriptLexers[n])
+			scriptLexers[n]->WordListSet(0, wl);
+	}
 	return firstModification;
 }
 
+ILexer4 *LexerHTML::ScriptLexer(script_type scriptLanguage) {
+	if (!scriptLexers[scriptLanguage]) {
+		ILexer4 *lexer = StylesForScript(scriptLanguage)->module->Create();
+		if (scriptLanguage == eScriptJS) {
+			lexer->PropertySet("lexer.cpp.track.preprocessor", "0");
+			lexer->PropertySet("lexer.cpp.backquoted.strings", "1");
+		}
+		lexer->WordListSet(0, scriptKeywords[scriptLanguage].c_str());
+		scriptLexers[scriptLanguage] = lexer;
+	}
+	return scriptLexers[scriptLanguage];
+}
+
+// Style the client-side script from start with its own lexer up to the end of the range or
+// the next "</", "<?" or "<%", which the HTML lexer then handles in the script's state.
+// The region is continued from start in initStyle and the unmapped styles are returned in
+// styles. Returns the position of the stop.
+Sci_Position LexerHTML::LexScript(Sci_Position start, Sci_Position lengthDoc, script_type scriptLanguage,
+	ScriptRegion region, int initStyle, Accessor &styler, IDocument *pAccess, std::vector<char> &styles) {
+	Sci_Position stop = start;
+	while (stop < lengthDoc) {
+		if (styler[stop] == '<') {
+			const char chNext = styler.SafeGetCharAt(stop + 1);
+			if (chNext == '/' || chNext == '?' || chNext == '%')
+				break;
+		}
+		stop++;
+	}
+	// The script lexers may move back to the start of the previous line, which is the start of
+	// the region when it starts on that line. Only a region starting in the default style can
+	// be continued then, so others are lexed again from their start.
+	Sci_Position lexFrom = start;
+	if (region.startStyle != 0) {
+		lexFrom = region.start;
+		initStyle = region.startStyle;
+	}
+	const Sci_Position end = std::min(stop + 1, lengthDoc);
+	styles.assign(end - start, 0);
+	styler.Flush();
+	assert((region.start >= 0) && (lexFrom >= region.start));
+	ScriptDocument scriptDocument(pAccess, region.start, *StylesForScript(scriptLanguage), scriptLineEnds, start, styles);
+	ScriptLexer(scriptLanguage)->Lex(lexFrom - region.start, end - lexFrom, initStyle, &scriptDocument);
+	styler.StartAt(stop);
+	styler.StartSegment(stop);
+	return stop;
+}
+
 void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	Accessor styler(pAccess, nullptr);
 	if (isPHPScript && (startPos == 0)) {
@@ -938,8 +1369,15 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 		}
 		state = SCE_H_DEFAULT;
 	}
-	// String can be heredoc, must find a delimiter first. Reread from beginning of line containing the string, to get the correct lineState
-	if (isPHPStringState(state)) {
+	// String can be heredoc, must find a delimiter first. When the delimiter open at the end of the
+	// previous line is known, continue the string from here. Otherwise reread from beginning of line
+	// containing the string, to get the correct lineState
+	bool resumeString = false;
+	if (isPHPStringState(state) && startPos > 0 && isLineEnd(styler[startPos - 1])) {
+		phpStringDelimiter = phpStringDelimiters.ValueAt(styler.GetLine(startPos) - 1);
+		resumeString = !phpStringDelimiter.empty();
+	}
+	if (isPHPStringState(state) && !resumeString) {
 		while (startPos > 0 && (isPHPStringState(state) || !isLineEnd(styler[startPos - 1]))) {
 			startPos--;
 			length++;
@@ -949,6 +1387,8 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 			state = SCE_H_DEFAULT;
 	}
 	styler.StartAt(startPos);
+	phpStringDelimiters.Delete(styler.GetLine(startPos));
+	scriptLineEnds.Delete(styler.GetLine(startPos));
 
 	/* Nothing handles getting out of these, so we need not start in any of them.
 	 * As we're at line start and they can't span lines, we'll re-detect them anyway */
@@ -995,6 +1435,7 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	const bool allowScripts = options.allowScripts;
 	const bool isMako = options.isMako;
 	const bool isDjango = options.isDjango;
+	const bool useScriptLexers = options.scriptLexers && !isMako && !isDjango;
 	const CharacterSet setHTMLWord(CharacterSet::setAlphaNum, ".-_:!#", 0x80, true);
 	const CharacterSet setTagContinue(CharacterSet::setAlphaNum, ".-_:!#[", 0x80, true);
 	const CharacterSet setAttributeContinue(CharacterSet::setAlphaNum, ".-_:!#/", 0x80, true);
@@ -1007,8 +1448,15 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	int lineStartVisibleChars = 0;
 
 	int chPrev = ' ';
-	int ch = ' ';
+	// A heredoc delimiter is only recognised after a line end
+	int ch = resumeString ? static_cast<unsigned char>(styler[startPos - 1]) : ' ';
 	int chPrevNonWhite = ' ';
+	// Range styled by a script lexer, ending at the stop handled by the HTML lexer
+	const ScriptStyles *scriptStyles = nullptr;
+	std::vector<char> scriptLexerStyles;
+	ScriptRegion scriptRegion;
+	Sci_Position scriptStart = -1;
+	Sci_Position scriptStop = -1;
 	// look back to set chPrevNonWhite properly for better regex colouring
 	if (scriptLanguage == eScriptJS && startPos > 0) {
 		Sci_Position back = startPos;
@@ -1043,6 +1491,47 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 			continue;
 		}
 
+		if (useScriptLexers && (i > scriptStop) && (inScriptType == eNonHtmlScript) &&
+			StylesForScript(ScriptOfState(state)) &&
+			!((state == SCE_HJ_START || state == SCE_HB_START || state == SCE_HP_START) && isLineEnd(ch))) {
+			const script_type language = ScriptOfState(state);
+			const bool lineComment = (state == SCE_HJ_COMMENTLINE) || (state == SCE_HB_COMMENTLINE) || (state == SCE_HP_COMMENTLINE);
+			ScriptLineEnd lineEnd;
+			if ((i == static_cast<Sci_Position>(startPos)) && (lineCurrent > 0) && (styler.LineStart(lineCurrent) == i))
+				lineEnd = scriptLineEnds.ValueAt(lineCurrent - 1);
+			int initStyle = -1;
+			if (lineEnd.InRegion() && (StylesForScript(language)->StyleHTML(lineEnd.style) == state)) {
+				// Lexing starts on a line continuing a region. The recorded start is only used
+				// when the region can still start there, otherwise it is found again.
+				scriptRegion = lineEnd.Region(i);
+				if ((scriptRegion.start > i) || !ScriptRegionCanStart(styler, scriptRegion.start, language))
+					scriptRegion = ScriptRegion(ScriptRegionStart(styler, i, language), 0);
+				initStyle = lineEnd.style;
+			} else if (lineComment) {
+				// The inline lexing finishes a line comment, as after "<" in it the VBScript
+				// lexer would not continue the comment
+			} else if ((scriptStart >= 0) && (i == scriptStop + 1) && (StylesForScript(language) == scriptStyles)) {
+				// Still in the script after "<" in a string or comment, so continue its region
+				initStyle = scriptLexerStyles[scriptStop - scriptStart];
+			} else {
+				initStyle = StylesForScript(language)->StyleScript(state);
+				scriptRegion = ScriptRegion(i, initStyle);
+			}
+			if (initStyle >= 0) {
+				styler.ColourTo(i - 1, statePrintForState(state, inScriptType));
+				scriptStyles = StylesForScript(language);
+				scriptStart = i;
+				scriptStop = LexScript(i, lengthDoc, language, scriptRegion, initStyle, styler, pAccess, scriptLexerStyles);
+			}
+		}
+		if ((i >= scriptStart) && (i <= scriptStop)) {
+			const int statePrev = (i == scriptStart) ? state : scriptStyles->StyleHTML(scriptLexerStyles[i - scriptStart - 1]);
+			state = scriptStyles->StyleHTML(scriptLexerStyles[i - scriptStart]);
+			// Fold the start of a block comment as code, as the inline JavaScript lexing does
+			if ((i < scriptStop) && (state == SCE_HJ_COMMENT || state == SCE_HJ_COMMENTDOC) && (state != statePrev))
+				state = SCE_HJ_DEFAULT;
+		}
+
 		if ((!IsASpace(ch) || !foldCompact) && fold)
 			visibleChars++;
 		if (!IsASpace(ch))
@@ -1131,10 +1620,23 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 			                    ((aspScript & 0x0F) << 4) |
 			                    ((clientScript & 0x0F) << 8) |
 			                    ((beforePreProc & 0xFF) << 12));
+			if (isPHPStringState(state))
+				phpStringDelimiters.Set(lineCurrent, phpStringDelimiter);
+			if (useScriptLexers) {
+				// Keyed by the line of i as lineCurrent falls behind when the line end
+				// after "</" is skipped
+				scriptLineEnds.Set(styler.GetLine(i), ((i >= scriptStart) && (i < scriptStop)) ?
+					ScriptLineEnd(scriptRegion, i + 1, scriptLexerStyles[i - scriptStart]) : ScriptLineEnd());
+			}
 			lineCurrent++;
 			lineStartVisibleChars = 0;
 		}
 
+		// Styled by the script lexer
+		if ((i >= scriptStart) && (i < scriptStop)) {
+			continue;
+		}
+
 		// handle start of Mako comment line
 		if (isMako && ch == '#' && chNext == '#') {
 			makoComment = 1;
@@ -2290,8 +2792,8 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 			}
 			break;
 		case SCE_HPHP_HSTRING:
-			if (ch == '\\' && ((phpStringDelimiter == "\"") || chNext == '$' || chNext == '{')) {
-				// skip the next char
+			if (ch == '\\' && ((phpStringDelimiter == "\"" && !isLineEnd(chNext)) || chNext == '$' || chNext == '{')) {
+				// skip the next char, but not a line end so the line state is still recorded
 				i++;
 			} else if (((ch == '{' && chNext == '$') || (ch == '$' && chNext == '{'))
 				&& IsPhpWordStart(chNext2)) {
@@ -2310,7 +2812,7 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 					const char chAfterPsd2 = styler.SafeGetCharAt(i + psdLength + 1);
 					if (isLineEnd(chAfterPsd) ||
 						(chAfterPsd == ';' && isLineEnd(chAfterPsd2))) {
-							i += (((i + psdLength) < lengthDoc) ? psdLength : lengthDoc) - 1;
+							i += (((i + psdLength) < lengthDoc) ? psdLength : lengthDoc - i) - 1;
 						styler.ColourTo(i, StateToPrint);
 						state = SCE_HPHP_DEFAULT;
 						if (foldHeredoc) levelCurrent--;
@@ -2320,8 +2822,8 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 			break;
 		case SCE_HPHP_SIMPLESTRING:
 			if (phpStringDelimiter == "\'") {
-				if (ch == '\\') {
-					// skip the next char
+				if (ch == '\\' && !isLineEnd(chNext)) {
+					// skip the next char, but not a line end so the line state is still recorded
 					i++;
 				} else if (ch == '\'') {
 					styler.ColourTo(i, StateToPrint);
@@ -2333,7 +2835,7 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 				const char chAfterPsd2 = styler.SafeGetCharAt(i + psdLength + 1);
 				if (isLineEnd(chAfterPsd) ||
 				(chAfterPsd == ';' && isLineEnd(chAfterPsd2))) {
-					i += (((i + psdLength) < lengthDoc) ? psdLength : lengthDoc) - 1;
+					i += (((i + psdLength) < lengthDoc) ? psdLength : lengthDoc - i) - 1;
 					styler.ColourTo(i, StateToPrint);
 					state = SCE_HPHP_DEFAULT;
 					if (foldHeredoc) levelCurrent--;
@@ -2435,24 +2937,29 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 		}
 	}
 
-	switch (state) {
-	case SCE_HJ_WORD:
-		classifyWordHTJS(styler.GetStartSegment(), lengthDoc - 1, keywords2, styler, inScriptType);
-		break;
-	case SCE_HB_WORD:
-		classifyWordHTVB(styler.GetStartSegment(), lengthDoc - 1, keywords3, styler, inScriptType);
-		break;
-	case SCE_HP_WORD:
-		classifyWordHTPy(styler.GetStartSegment(), lengthDoc - 1, keywords4, styler, prevWord, inScriptType, isMako);
-		break;
-	case SCE_HPHP_WORD:
-		classifyWordHTPHP(styler.GetStartSegment(), lengthDoc - 1, keywords5, styler);
-		break;
-	default:
-		StateToPrint = statePrintForState(state, inScriptType);
-		if (static_cast<Sci_Position>(styler.GetStartSegment()) < lengthDoc)
-			styler.ColourTo(lengthDoc - 1, StateToPrint);
-		break;
+	// Nothing is left to colour when the range ends inside a script styled by its own lexer
+	// or the last segment has been coloured. A word classified from beyond its end would read
+	// the whole document.
+	if (static_cast<Sci_Position>(styler.GetStartSegment()) < lengthDoc) {
+		switch (state) {
+		case SCE_HJ_WORD:
+			classifyWordHTJS(styler.GetStartSegment(), lengthDoc - 1, keywords2, styler, inScriptType);
+			break;
+		case SCE_HB_WORD:
+			classifyWordHTVB(styler.GetStartSegment(), lengthDoc - 1, keywords3, styler, inScriptType);
+			break;
+		case SCE_HP_WORD:
+			classifyWordHTPy(styler.GetStartSegment(), lengthDoc - 1, keywords4, styler, prevWord, inScriptType, isMako);
+			break;
+		case SCE_HPHP_WORD:
+			classifyWordHTPHP(styler.GetStartSegment(), lengthDoc - 1, keywords5, styler);
+			break;
+		default:
+			StateToPrint = statePrintForState(state, inScriptType);
+			if (static_cast<Sci_Position>(styler.GetStartSegment()) < lengthDoc)
+				styler.ColourTo(lengthDoc - 1, StateToPrint);
+			break;
+		}
 	}
 
 	// Fill in the real level of the next line, keeping the current flags as they will be filled in later
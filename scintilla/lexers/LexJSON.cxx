@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -137,6 +138,8 @@ class LexerJSON : public DefaultLexer {
 	CharacterSet setURL;
 	CharacterSet setKeywordJSONLD;
 	CharacterSet setKeywordJSON;
+	CharacterSet setStringPlain;
+	CharacterSet setURIStart;
 	CompactIRI compactIRI;
 
 	static bool IsNextNonWhitespace(LexAccessor &styler, Sci_Position start, char ch) {
@@ -182,6 +185,53 @@ class LexerJSON : public DefaultLexer {
 		return false;
 	}
 
+	static bool AtURIScheme(LexAccessor &styler, Sci_Position pos) {
+		// Handle most common URI schemes only
+		static const char *const schemes[] = {
+			"https://", "http://", "ssh://", "git://", "svn://", "ftp://", "mailto:"
+		};
+		const char ch = styler[pos];
+		for (const char *scheme : schemes) {
+			if (scheme[0] == ch && styler.Match(pos, scheme)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Finds the end of the run of single byte string characters starting at pos
+	 * that need no more handling than checking for a compact IRI, so that the
+	 * run can be passed over in one step
+	 */
+	Sci_Position PlainStringEnd(LexAccessor &styler, Sci_Position pos, Sci_Position endPos) const {
+		const CharacterSet &setPlain = compactIRI.foundInvalidChar ? setStringPlain : compactIRI.setCompactIRI;
+		while (pos < endPos) {
+			const unsigned char ch = styler[pos];
+			if (!setPlain.Contains(ch) || (setURIStart.Contains(ch) && AtURIScheme(styler, pos))) {
+				break;
+			}
+			pos++;
+		}
+		return pos;
+	}
+
+	static Sci_Position BlankEnd(LexAccessor &styler, Sci_Position pos, Sci_Position endPos) {
+		while (pos < endPos && IsASpaceOrTab(styler[pos])) {
+			pos++;
+		}
+		return pos;
+	}
+
+	static bool IsBlankLine(LexAccessor &styler, Sci_Position pos, Sci_Position endPos) {
+		for (; pos < endPos; pos++) {
+			if (!isspacechar(styler[pos])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
 	static bool IsNextWordInList(WordList &keywordList, CharacterSet wordSet,
 								 StyleContext &context, LexAccessor &styler) {
 		char word[51];
@@ -204,7 +254,9 @@ class LexerJSON : public DefaultLexer {
 		setOperators(CharacterSet::setNone, "[{}]:,"),
 		setURL(CharacterSet::setAlphaNum, "-._~:/?#[]@!$&'()*+,),="),
 		setKeywordJSONLD(CharacterSet::setAlpha, ":@"),
-		setKeywordJSON(CharacterSet::setAlpha, "$_") {
+		setKeywordJSON(CharacterSet::setAlpha, "$_"),
+		setStringPlain(CharacterSet::setAlphaNum, "\t !#$%&'()*+,-./:;<=>?[]^_`{|}~"),
+		setURIStart(CharacterSet::setNone, "fghms") {
 	}
 	virtual ~LexerJSON() {}
 	int SCI_METHOD Version() const override {
@@ -274,7 +326,13 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 							   IDocument *pAccess) {
 	LexAccessor styler(pAccess);
 	StyleContext context(startPos, length, initStyle, styler);
+	const Sci_Position endPos = startPos + length;
 	int stringStyleBefore = SCE_JSON_STRING;
+	// The bracket nesting level at the end of each line is kept as its line
+	// state so folding does not have to read the text again
+	int levelNext = SC_FOLDLEVELBASE;
+	if (context.currentLine > 0)
+		levelNext = styler.GetLineState(context.currentLine - 1);
 	while (context.More()) {
 		switch (context.state) {
 			case SCE_JSON_BLOCKCOMMENT:
@@ -337,14 +395,7 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 						}
 					}
 					context.Forward();
-				} else if (context.Match("https://") ||
-						   context.Match("http://") ||
-						   context.Match("ssh://") ||
-						   context.Match("git://") ||
-						   context.Match("svn://") ||
-						   context.Match("ftp://") ||
-						   context.Match("mailto:")) {
-					// Handle most common URI schemes only
+				} else if (AtURIScheme(styler, context.currentPos)) {
 					stringStyleBefore = context.state;
 					context.SetState(SCE_JSON_URI);
 				} else if (context.ch == '@') {
@@ -355,6 +406,11 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 					}
 				} else {
 					compactIRI.checkChar(context.ch);
+					const Sci_Position plainEnd = PlainStringEnd(styler, context.currentPos + context.width, endPos);
+					if (plainEnd > static_cast<Sci_Position>(context.currentPos + context.width)) {
+						context.SkipTo(plainEnd);
+						continue;
+					}
 				}
 				break;
 			case SCE_JSON_LDKEYWORD:
@@ -395,6 +451,11 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 				}
 			} else if (setOperators.Contains(context.ch)) {
 				context.SetState(SCE_JSON_OPERATOR);
+				if (context.ch == '{' || context.ch == '[') {
+					levelNext++;
+				} else if (context.ch == '}' || context.ch == ']') {
+					levelNext--;
+				}
 			} else if (options.allowComments && context.Match("/*")) {
 				context.SetState(SCE_JSON_BLOCKCOMMENT);
 				context.Forward();
@@ -439,10 +500,23 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 				context.SetState(SCE_JSON_NUMBER);
 			} else if (context.state == SCE_JSON_DEFAULT && !IsASpace(context.ch)) {
 				context.SetState(SCE_JSON_ERROR);
+			} else if (context.state == SCE_JSON_DEFAULT && IsASpaceOrTab(context.ch)) {
+				const Sci_Position blankEnd = BlankEnd(styler, context.currentPos + 1, endPos);
+				if (blankEnd > static_cast<Sci_Position>(context.currentPos + 1)) {
+					context.SkipTo(blankEnd);
+					continue;
+				}
 			}
 		}
+		if (context.atLineEnd) {
+			styler.SetLineState(context.currentLine, levelNext);
+		}
 		context.Forward();
 	}
+	if (!context.atLineStart) {
+		// Partial last line
+		styler.SetLineState(context.currentLine, levelNext);
+	}
 	context.Complete();
 }
 
@@ -454,41 +528,28 @@ void SCI_METHOD LexerJSON::Fold(Sci_PositionU startPos,
 		return;
 	}
 	LexAccessor styler(pAccess);
-	Sci_PositionU currLine = styler.GetLine(startPos);
-	Sci_PositionU endPos = startPos + length;
+	// Lex has left the fold level after each line as its line state
+	Sci_Position currLine = styler.GetLine(startPos);
+	const Sci_Position endPos = startPos + length;
 	int currLevel = SC_FOLDLEVELBASE;
 	if (currLine > 0)
-		currLevel = styler.LevelAt(currLine - 1) >> 16;
-	int nextLevel = currLevel;
-	int visibleChars = 0;
-	for (Sci_PositionU i = startPos; i < endPos; i++) {
-		char curr = styler.SafeGetCharAt(i);
-		char next = styler.SafeGetCharAt(i+1);
-		bool atEOL = (curr == '\r' && next != '\n') || (curr == '\n');
-		if (styler.StyleAt(i) == SCE_JSON_OPERATOR) {
-			if (curr == '{' || curr == '[') {
-				nextLevel++;
-			} else if (curr == '}' || curr == ']') {
-				nextLevel--;
-			}
-		}
-		if (atEOL || i == (endPos-1)) {
-			int level = currLevel | nextLevel << 16;
-			if (!visibleChars && options.foldCompact) {
-				level |= SC_FOLDLEVELWHITEFLAG;
-			} else if (nextLevel > currLevel) {
-				level |= SC_FOLDLEVELHEADERFLAG;
-			}
-			if (level != styler.LevelAt(currLine)) {
-				styler.SetLevel(currLine, level);
-			}
-			currLine++;
-			currLevel = nextLevel;
-			visibleChars = 0;
+		currLevel = styler.GetLineState(currLine - 1);
+	Sci_Position lineStart = startPos;
+	while (lineStart < endPos) {
+		const Sci_Position lineNext = std::min(styler.LineStart(currLine + 1), endPos);
+		const int nextLevel = styler.GetLineState(currLine);
+		int level = currLevel | nextLevel << 16;
+		if (options.foldCompact && IsBlankLine(styler, lineStart, lineNext)) {
+			level |= SC_FOLDLEVELWHITEFLAG;
+		} else if (nextLevel > currLevel) {
+			level |= SC_FOLDLEVELHEADERFLAG;
 		}
-		if (!isspacechar(curr)) {
-			visibleChars++;
+		if (level != styler.LevelAt(currLine)) {
+			styler.SetLevel(currLine, level);
 		}
+		currLine++;
+		currLevel = nextLevel;
+		lineStart = lineNext;
 	}
 }
 
@@ -20,6 +20,12 @@
  *  blocks would be better supported with language specific
  *  highlighting.
  *
+ *  Block structure is recorded in each line's state as it is lexed:
+ *  whether the line lies in a delimited code block, is a heading or
+ *  setext underline, or starts a list item and how far that item is
+ *  indented. Folding reads the headings from there to present the
+ *  document outline.
+ *
  *  The highlighting aims to accurately reflect correct syntax,
  *  but a few restrictions are relaxed. Delimited code blocks are
  *  highlighted, even if the line following the code block is not blank.
@@ -40,6 +46,8 @@
 #include <stdarg.h>
 #include <assert.h>
 
+#include <algorithm>
+
 #include "ILexer.h"
 #include "Scintilla.h"
 #include "SciLexer.h"
@@ -53,6 +61,17 @@
 
 using namespace Scintilla;
 
+// Line state layout
+enum {
+    mdLineFence = 0x1,          // inside or delimiting a ~~~ code block
+    mdLineSetext = 0x2,         // '=' or '-' underline making the line above a heading
+    mdLineList = 0x4,           // starts a list item
+    mdHeadingShift = 4,         // heading level 1-6, 0 when not a heading
+    mdHeadingMask = 0x7 << mdHeadingShift,
+    mdListIndentShift = 8,      // spaces before the list item marker
+    mdListIndentMask = 0x3 << mdListIndentShift
+};
+
 static inline bool IsNewline(const int ch) {
     return (ch == '\n' || ch == '\r');
 }
@@ -66,8 +85,10 @@ static bool FollowToLineEnd(const int ch, const int state, const Sci_PositionU e
     while (IsASpaceOrTab(sc.GetRelative(i)) && sc.currentPos + i < endPos)
         ++i;
     if (IsNewline(sc.GetRelative(i)) || sc.currentPos + i == endPos) {
+        // Start the style at the underline so that the line end before it stays in
+        // SCE_MARKDOWN_LINE_BEGIN and restyling from the underline checks it again
+        sc.SetState(state);
         sc.Forward(i);
-        sc.ChangeState(state);
         sc.SetState(SCE_MARKDOWN_LINE_BEGIN);
         return true;
     }
@@ -97,15 +118,12 @@ static void SetStateAndZoom(const int state, const Sci_Position length, const in
 }
 
 // Does the previous line have more than spaces and tabs?
-static bool HasPrevLineContent(StyleContext &sc) {
-    Sci_Position i = 0;
-    // Go back to the previous newline
-    while ((--i + (Sci_Position)sc.currentPos) >= 0 && !IsNewline(sc.GetRelative(i)))
-        ;
-    while ((--i + (Sci_Position)sc.currentPos) >= 0) {
-        if (IsNewline(sc.GetRelative(i)))
-            break;
-        if (!IsASpaceOrTab(sc.GetRelative(i)))
+static bool HasPrevLineContent(const Sci_Position line, Accessor &styler) {
+    if (line <= 0)
+        return false;
+    const Sci_Position lineStart = styler.LineStart(line);
+    for (Sci_Position i = styler.LineStart(line - 1); i < lineStart; i++) {
+        if (!IsASpaceOrTab(styler[i]) && !IsNewline(styler[i]))
             return true;
     }
     return false;
@@ -115,7 +133,7 @@ static bool AtTermStart(StyleContext &sc) {
     return sc.currentPos == 0 || sc.chPrev == 0 || isspacechar(sc.chPrev);
 }
 
-static bool IsValidHrule(const Sci_PositionU endPos, StyleContext &sc) {
+static bool IsValidHrule(const Sci_PositionU endPos, const Sci_Position line, Accessor &styler, StyleContext &sc) {
     int count = 1;
     Sci_PositionU i = 0;
     for (;;) {
@@ -127,7 +145,7 @@ static bool IsValidHrule(const Sci_PositionU endPos, StyleContext &sc) {
         else if (!IsASpaceOrTab(c) || sc.currentPos + i == endPos) {
             // Are we a valid HRULE
             if ((IsNewline(c) || sc.currentPos + i == endPos) &&
-                    count >= 3 && !HasPrevLineContent(sc)) {
+                    count >= 3 && !HasPrevLineContent(line, styler)) {
                 sc.SetState(SCE_MARKDOWN_HRULE);
                 sc.Forward(i);
                 sc.SetState(SCE_MARKDOWN_LINE_BEGIN);
@@ -152,7 +170,21 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
 
     StyleContext sc(startPos, length, initStyle, styler);
 
+    Sci_Position lineCurrent = sc.currentLine;
+    int lineState = (initStyle == SCE_MARKDOWN_CODEBK) ? mdLineFence : 0;
+    // Store the state of each line finished before line
+    auto storeLineStates = [&](Sci_Position line) {
+        while (lineCurrent < line) {
+            styler.SetLineState(lineCurrent, lineState);
+            lineCurrent++;
+            lineState = (sc.state == SCE_MARKDOWN_CODEBK) ? mdLineFence : 0;
+        }
+    };
+
     while (sc.More()) {
+        if (sc.currentLine > lineCurrent)
+            storeLineStates(sc.currentLine);
+
         // Skip past escaped characters
         if (sc.ch == '\\') {
             sc.Forward();
@@ -238,16 +270,17 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
         }
         else if (sc.state == SCE_MARKDOWN_LINE_BEGIN) {
             // Header
+            int heading = 0;
             if (sc.Match("######"))
-                SetStateAndZoom(SCE_MARKDOWN_HEADER6, 6, '#', sc);
+                heading = 6;
             else if (sc.Match("#####"))
-                SetStateAndZoom(SCE_MARKDOWN_HEADER5, 5, '#', sc);
+                heading = 5;
             else if (sc.Match("####"))
-                SetStateAndZoom(SCE_MARKDOWN_HEADER4, 4, '#', sc);
+                heading = 4;
             else if (sc.Match("###"))
-                SetStateAndZoom(SCE_MARKDOWN_HEADER3, 3, '#', sc);
+                heading = 3;
             else if (sc.Match("##"))
-                SetStateAndZoom(SCE_MARKDOWN_HEADER2, 2, '#', sc);
+                heading = 2;
             else if (sc.Match("#")) {
                 // Catch the special case of an unordered list
                 if (sc.chNext == '.' && IsASpaceOrTab(sc.GetRelative(2))) {
@@ -255,24 +288,32 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
                     sc.SetState(SCE_MARKDOWN_PRECHAR);
                 }
                 else
-                    SetStateAndZoom(SCE_MARKDOWN_HEADER1, 1, '#', sc);
+                    heading = 1;
+            }
+            if (heading) {
+                lineState |= heading << mdHeadingShift;
+                SetStateAndZoom(SCE_MARKDOWN_HEADER1 + heading - 1, heading, '#', sc);
             }
+            else if (sc.state == SCE_MARKDOWN_PRECHAR)
+                ;
             // Code block
             else if (sc.Match("~~~")) {
-                if (!HasPrevLineContent(sc))
+                if (!HasPrevLineContent(lineCurrent, styler)) {
+                    lineState |= mdLineFence;
                     sc.SetState(SCE_MARKDOWN_CODEBK);
+                }
                 else
                     sc.SetState(SCE_MARKDOWN_DEFAULT);
             }
             else if (sc.ch == '=') {
-                if (HasPrevLineContent(sc) && FollowToLineEnd('=', SCE_MARKDOWN_HEADER1, endPos, sc))
-                    ;
+                if (HasPrevLineContent(lineCurrent, styler) && FollowToLineEnd('=', SCE_MARKDOWN_HEADER1, endPos, sc))
+                    lineState |= mdLineSetext | (1 << mdHeadingShift);
                 else
                     sc.SetState(SCE_MARKDOWN_DEFAULT);
             }
             else if (sc.ch == '-') {
-                if (HasPrevLineContent(sc) && FollowToLineEnd('-', SCE_MARKDOWN_HEADER2, endPos, sc))
-                    ;
+                if (HasPrevLineContent(lineCurrent, styler) && FollowToLineEnd('-', SCE_MARKDOWN_HEADER2, endPos, sc))
+                    lineState |= mdLineSetext | (2 << mdHeadingShift);
                 else {
                     precharCount = 0;
                     sc.SetState(SCE_MARKDOWN_PRECHAR);
@@ -306,10 +347,11 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
             */
             // HRule - Total of three or more hyphens, asterisks, or underscores
             // on a line by themselves
-            else if ((sc.ch == '-' || sc.ch == '*' || sc.ch == '_') && IsValidHrule(endPos, sc))
+            else if ((sc.ch == '-' || sc.ch == '*' || sc.ch == '_') && IsValidHrule(endPos, lineCurrent, styler, sc))
                 ;
             // Unordered list
             else if ((sc.ch == '-' || sc.ch == '*' || sc.ch == '+') && IsASpaceOrTab(sc.chNext)) {
+                lineState |= mdLineList | (precharCount << mdListIndentShift);
                 sc.SetState(SCE_MARKDOWN_ULIST_ITEM);
                 sc.ForwardSetState(SCE_MARKDOWN_DEFAULT);
             }
@@ -320,6 +362,7 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
                     ;
                 if (sc.GetRelative(digitCount) == '.' &&
                         IsASpaceOrTab(sc.GetRelative(digitCount + 1))) {
+                    lineState |= mdLineList | (precharCount << mdListIndentShift);
                     sc.SetState(SCE_MARKDOWN_OLIST_ITEM);
                     sc.Forward(digitCount + 1);
                     sc.SetState(SCE_MARKDOWN_DEFAULT);
@@ -327,6 +370,7 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
             }
             // Alternate Ordered list
             else if (sc.ch == '#' && sc.chNext == '.' && IsASpaceOrTab(sc.GetRelative(2))) {
+                lineState |= mdLineList | (precharCount << mdListIndentShift);
                 sc.SetState(SCE_MARKDOWN_OLIST_ITEM);
                 sc.Forward(2);
                 sc.SetState(SCE_MARKDOWN_DEFAULT);
@@ -413,7 +457,52 @@ static void ColorizeMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int
             sc.Forward();
         freezeCursor = false;
     }
+    // The context moves one past the end of the document
+    const Sci_PositionU posEnd = std::min(sc.currentPos, static_cast<Sci_PositionU>(styler.Length()));
+    storeLineStates(std::min(sc.currentLine, sc.lineDocEnd));
+    // Partial last line, lexed again from its start next time
+    if (posEnd > static_cast<Sci_PositionU>(styler.LineStart(lineCurrent)))
+        styler.SetLineState(lineCurrent, lineState);
     sc.Complete();
 }
 
-LexerModule lmMarkdown(SCLEX_MARKDOWN, ColorizeMarkdownDoc, "markdown");
+// Heading level of a line, taking a setext underline on the next line into account
+static int HeadingLevel(const Sci_Position line, Accessor &styler) {
+    const int lineState = styler.GetLineState(line);
+    if (!(lineState & (mdLineSetext | mdLineFence)) && (lineState & mdHeadingMask))
+        return (lineState & mdHeadingMask) >> mdHeadingShift;
+    const int lineStateNext = styler.GetLineState(line + 1);
+    if ((lineStateNext & mdLineSetext) && !(lineState & mdLineFence))
+        return (lineStateNext & mdHeadingMask) >> mdHeadingShift;
+    return 0;
+}
+
+// Fold each heading over the lines up to the next heading of the same or a higher level
+static void FoldMarkdownDoc(Sci_PositionU startPos, Sci_Position length, int, WordList *[], Accessor &styler) {
+    if (length <= 0)
+        return;
+    const Sci_Position lineLast = styler.GetLine(startPos + length - 1);
+    Sci_Position lineCurrent = styler.GetLine(startPos);
+    // An underline on the first line may have made the line before a heading
+    if (lineCurrent > 0)
+        lineCurrent--;
+    int headingLevel = 0;
+    if (lineCurrent > 0) {
+        const int levelPrev = styler.LevelAt(lineCurrent - 1);
+        headingLevel = (levelPrev & SC_FOLDLEVELNUMBERMASK) - SC_FOLDLEVELBASE;
+        if (levelPrev & SC_FOLDLEVELHEADERFLAG)
+            headingLevel++;
+    }
+    for (; lineCurrent <= lineLast; lineCurrent++) {
+        const int heading = HeadingLevel(lineCurrent, styler);
+        int lev = SC_FOLDLEVELBASE + headingLevel;
+        if (heading) {
+            lev = (SC_FOLDLEVELBASE + heading - 1) | SC_FOLDLEVELHEADERFLAG;
+            headingLevel = heading;
+        }
+        if (lev != styler.LevelAt(lineCurrent))
+            styler.SetLevel(lineCurrent, lev);
+    }
+}
+
+LexerModule lmMarkdown(SCLEX_MARKDOWN, ColorizeMarkdownDoc, "markdown", FoldMarkdownDoc);
@@ -359,8 +359,8 @@ static void ColouriseModulaDoc(	Sci_PositionU startPos,
 				sc.Forward();
 			}
 			else
-			if( isalpha( sc.ch ) ) {
-				if( isupper( sc.ch ) && isupper( sc.chNext ) ) {
+			if( IsASCII( sc.ch ) && isalpha( sc.ch ) ) {
+				if( isupper( sc.ch ) && IsASCII( sc.chNext ) && isupper( sc.chNext ) ) {
 					for( i = 0; i < BUFLEN - 1; i++ ) {
 						buf[i] = sc.GetRelative(i);
 						if( !isalpha( buf[i] ) && !(buf[i] == '_') )
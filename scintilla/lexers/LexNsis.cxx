@@ -101,6 +101,16 @@ static bool NsisNextLineHasElse(Sci_PositionU start, Sci_PositionU end, Accessor
   return false;
 }
 
+// Options are read once per lex or fold call rather than for each word or character
+struct OptionsNsis {
+  bool ignoreCase;
+  bool userVars;
+  explicit OptionsNsis( Accessor &styler ) :
+    ignoreCase(styler.GetPropertyInt("nsis.ignorecase") == 1),
+    userVars(styler.GetPropertyInt("nsis.uservars") == 1) {
+  }
+};
+
 static int NsisCmp( const char *s1, const char *s2, bool bIgnoreCase )
 {
   if( bIgnoreCase )
@@ -109,7 +119,7 @@ static int NsisCmp( const char *s1, const char *s2, bool bIgnoreCase )
   return strcmp( s1, s2 );
 }
 
-static int calculateFoldNsis(Sci_PositionU start, Sci_PositionU end, int foldlevel, Accessor &styler, bool bElse, bool foldUtilityCmd )
+static int calculateFoldNsis(Sci_PositionU start, Sci_PositionU end, int foldlevel, Accessor &styler, bool bElse, bool foldUtilityCmd, bool bIgnoreCase )
 {
   int style = styler.StyleAt(end);
 
@@ -135,9 +145,6 @@ static int calculateFoldNsis(Sci_PositionU start, Sci_PositionU end, int foldlev
   }
 
   int newFoldlevel = foldlevel;
-  bool bIgnoreCase = false;
-  if( styler.GetPropertyInt("nsis.ignorecase") == 1 )
-    bIgnoreCase = true;
 
   char s[20]; // The key word we are looking for has atmost 13 characters
   s[0] = '\0';
@@ -167,15 +174,10 @@ static int calculateFoldNsis(Sci_PositionU start, Sci_PositionU end, int foldlev
   return newFoldlevel;
 }
 
-static int classifyWordNsis(Sci_PositionU start, Sci_PositionU end, WordList *keywordLists[], Accessor &styler )
+static int classifyWordNsis(Sci_PositionU start, Sci_PositionU end, WordList *keywordLists[], Accessor &styler, const OptionsNsis &options )
 {
-  bool bIgnoreCase = false;
-  if( styler.GetPropertyInt("nsis.ignorecase") == 1 )
-    bIgnoreCase = true;
-
-  bool bUserVars = false;
-  if( styler.GetPropertyInt("nsis.uservars") == 1 )
-    bUserVars = true;
+  const bool bIgnoreCase = options.ignoreCase;
+  const bool bUserVars = options.userVars;
 
 	char s[100];
 	s[0] = '\0';
@@ -280,6 +282,7 @@ static int classifyWordNsis(Sci_PositionU start, Sci_PositionU end, WordList *ke
 
 static void ColouriseNsisDoc(Sci_PositionU startPos, Sci_Position length, int, WordList *keywordLists[], Accessor &styler)
 {
+	const OptionsNsis options(styler);
 	int state = SCE_NSIS_DEFAULT;
   if( startPos > 0 )
     state = styler.StyleAt(startPos-1); // Use the style from the previous line, usually default, but could be commentbox
@@ -445,13 +448,13 @@ static void ColouriseNsisDoc(Sci_PositionU startPos, Sci_Position length, int, W
           state = SCE_NSIS_DEFAULT;
 				else if( (isNsisChar(cCurrChar) && !isNsisChar( cNextChar) && cNextChar != '}') || cCurrChar == '}' )
 				{
-					state = classifyWordNsis( styler.GetStartSegment(), i, keywordLists, styler );
+					state = classifyWordNsis( styler.GetStartSegment(), i, keywordLists, styler, options );
 					styler.ColourTo( i, state);
 					state = SCE_NSIS_DEFAULT;
 				}
 				else if( !isNsisChar( cCurrChar ) && cCurrChar != '{' && cCurrChar != '}' )
 				{
-          if( classifyWordNsis( styler.GetStartSegment(), i-1, keywordLists, styler) == SCE_NSIS_NUMBER )
+          if( classifyWordNsis( styler.GetStartSegment(), i-1, keywordLists, styler, options) == SCE_NSIS_NUMBER )
              styler.ColourTo( i-1, SCE_NSIS_NUMBER );
 
 					state = SCE_NSIS_DEFAULT;
@@ -497,9 +500,7 @@ static void ColouriseNsisDoc(Sci_PositionU startPos, Sci_Position length, int, W
 		else if( state == SCE_NSIS_STRINGDQ || state == SCE_NSIS_STRINGLQ || state == SCE_NSIS_STRINGRQ )
 		{
       bool bIngoreNextDollarSign = false;
-      bool bUserVars = false;
-      if( styler.GetPropertyInt("nsis.uservars") == 1 )
-        bUserVars = true;
+      const bool bUserVars = options.userVars;
 
       if( bVarInString && cCurrChar == '$' )
       {
@@ -516,7 +517,7 @@ static void ColouriseNsisDoc(Sci_PositionU startPos, Sci_Position length, int, W
       // Covers "$INSTDIR and user vars like $MYVAR"
       else if( bVarInString && !isNsisChar(cNextChar) )
       {
-        int nWordState = classifyWordNsis( styler.GetStartSegment(), i, keywordLists, styler);
+        int nWordState = classifyWordNsis( styler.GetStartSegment(), i, keywordLists, styler, options);
 				if( nWordState == SCE_NSIS_VARIABLE )
 					styler.ColourTo( i, SCE_NSIS_STRINGVAR);
         else if( bUserVars )
@@ -558,6 +559,7 @@ static void FoldNsisDoc(Sci_PositionU startPos, Sci_Position length, int, WordLi
 
   bool foldAtElse = styler.GetPropertyInt("fold.at.else", 0) == 1;
   bool foldUtilityCmd = styler.GetPropertyInt("nsis.foldutilcmd", 1) == 1;
+  const bool bIgnoreCase = styler.GetPropertyInt("nsis.ignorecase") == 1;
   bool blockComment = false;
 
   Sci_Position lineCurrent = styler.GetLine(startPos);
@@ -601,7 +603,7 @@ static void FoldNsisDoc(Sci_PositionU startPos, Sci_Position length, int, WordLi
       }
       else if( isNsisLetter(chCurr) == false && nWordStart > -1 )
       {
-        int newLevel = calculateFoldNsis( nWordStart, i-1, levelNext, styler, foldAtElse, foldUtilityCmd );
+        int newLevel = calculateFoldNsis( nWordStart, i-1, levelNext, styler, foldAtElse, foldUtilityCmd, bIgnoreCase );
 
         if( newLevel == levelNext )
         {
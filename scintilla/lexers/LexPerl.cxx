@@ -15,7 +15,9 @@
 #include <ctype.h>
 
 #include <string>
+#include <vector>
 #include <map>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -27,6 +29,7 @@
 #include "CharacterSet.h"
 #include "LexerModule.h"
 #include "OptionSet.h"
+#include "SparseState.h"
 #include "DefaultLexer.h"
 
 using namespace Scintilla;
@@ -370,6 +373,39 @@ struct OptionsPerl {
 	}
 };
 
+class HereDocCls {	// Class to manage HERE doc sequence
+public:
+	int State;
+	// 0: '<<' encountered
+	// 1: collect the delimiter
+	// 2: here doc text (lines after the delimiter)
+	int Quote;		// the char after '<<'
+	bool Quoted;		// true if Quote in ('\'','"','`')
+	int DelimiterLength;	// strlen(Delimiter)
+	char Delimiter[HERE_DELIM_MAX];	// the Delimiter
+	HereDocCls() {
+		State = 0;
+		Quote = 0;
+		Quoted = false;
+		DelimiterLength = 0;
+		Delimiter[0] = '\0';
+	}
+	void Append(int ch) {
+		Delimiter[DelimiterLength++] = static_cast<char>(ch);
+		Delimiter[DelimiterLength] = '\0';
+	}
+	bool operator==(const HereDocCls &other) const {
+		return State == other.State && Quote == other.Quote && Quoted == other.Quoted &&
+			DelimiterLength == other.DelimiterLength &&
+			strcmp(Delimiter, other.Delimiter) == 0;
+	}
+	bool operator!=(const HereDocCls &other) const {
+		return !(*this == other);
+	}
+	~HereDocCls() {
+	}
+};
+
 static const char *const perlWordListDesc[] = {
 	"Keywords",
 	0
@@ -407,6 +443,9 @@ class LexerPerl : public DefaultLexer {
 	WordList keywords;
 	OptionsPerl options;
 	OptionSetPerl osPerl;
+	// Here doc state at the end of lines where a here doc body starts or ends, so
+	// lexing can restart inside a long here doc instead of at its delimiter.
+	SparseState<HereDocCls> hereDocStates;
 public:
 	LexerPerl() :
 		setWordStart(CharacterSet::setAlpha, "_", 0x80, true),
@@ -611,30 +650,6 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 	// which characters are being used as quotes, how deeply nested is the
 	// start position and what the termination string is for HERE documents.
 
-	class HereDocCls {	// Class to manage HERE doc sequence
-	public:
-		int State;
-		// 0: '<<' encountered
-		// 1: collect the delimiter
-		// 2: here doc text (lines after the delimiter)
-		int Quote;		// the char after '<<'
-		bool Quoted;		// true if Quote in ('\'','"','`')
-		int DelimiterLength;	// strlen(Delimiter)
-		char Delimiter[HERE_DELIM_MAX];	// the Delimiter
-		HereDocCls() {
-			State = 0;
-			Quote = 0;
-			Quoted = false;
-			DelimiterLength = 0;
-			Delimiter[0] = '\0';
-		}
-		void Append(int ch) {
-			Delimiter[DelimiterLength++] = static_cast<char>(ch);
-			Delimiter[DelimiterLength] = '\0';
-		}
-		~HereDocCls() {
-		}
-	};
 	HereDocCls HereDoc;		// TODO: FIFO for stacked here-docs
 
 	class QuoteCls {	// Class to manage quote pairs
@@ -665,11 +680,31 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 
 	Sci_PositionU endPos = startPos + length;
 
+	// Here doc and format bodies may be very long so continue them from the start of
+	// the line when their state is known. Format bodies need no state and here docs
+	// restore the delimiter remembered for the line before.
+	bool resumeBody = false;
+	if (startPos > 0 && static_cast<Sci_Position>(startPos) == styler.LineStart(styler.GetLine(startPos))) {
+		if (initStyle == SCE_PL_FORMAT) {
+			resumeBody = true;
+		} else if (initStyle == SCE_PL_HERE_Q
+		        || initStyle == SCE_PL_HERE_QQ
+		        || initStyle == SCE_PL_HERE_QX) {
+			const HereDocCls hereDocPrevious = hereDocStates.ValueAt(styler.GetLine(startPos) - 1);
+			if (hereDocPrevious.State == 2) {
+				HereDoc = hereDocPrevious;
+				resumeBody = true;
+			}
+		}
+	}
+
 	// Backtrack to beginning of style if required...
 	// If in a long distance lexical state, backtrack to find quote characters.
 	// Includes strings (may be multi-line), numbers (additional state), format
 	// bodies, as well as POD sections.
-	if (initStyle == SCE_PL_HERE_Q
+	if (resumeBody) {
+		// Start of current line is known to be inside the body
+	} else if (initStyle == SCE_PL_HERE_Q
 	    || initStyle == SCE_PL_HERE_QQ
 	    || initStyle == SCE_PL_HERE_QX
 	    || initStyle == SCE_PL_FORMAT
@@ -756,6 +791,8 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 		backPos++;
 	}
 
+	hereDocStates.Delete(styler.GetLine(startPos));
+
 	StyleContext sc(startPos, endPos - startPos, initStyle, styler);
 
 	for (; sc.More(); sc.Forward()) {
@@ -971,6 +1008,7 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 					sc.SetState(SCE_PL_DEFAULT);
 					backFlag = BACK_NONE;
 					HereDoc.State = 0;
+					hereDocStates.Set(styler.GetLine(sc.currentPos), HereDoc);
 					if (!sc.atLineEnd)
 						sc.Forward();
 					break;
@@ -1278,6 +1316,7 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 					st_new = SCE_PL_HERE_Q;
 			}
 			sc.SetState(st_new);
+			hereDocStates.Set(styler.GetLine(sc.currentPos), HereDoc);
 		}
 		if (HereDoc.State == 3 && sc.atLineEnd) {
 			// Start of format body.
@@ -13,6 +13,7 @@
 #include <ctype.h>
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <algorithm>
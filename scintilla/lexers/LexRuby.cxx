@@ -638,6 +638,104 @@ static bool sureThisIsNotHeredoc(Sci_Position lt2StartPos,
     return definitely_not_a_here_doc;
 }
 
+// How lexing can begin at the start of a line
+enum LineStartKind {
+    lineStartable,      // not inside a multi-line construct
+    lineContinued,      // continues a construct from the line before
+    lineNearDocStart    // close enough to the start to lex from there
+};
+
+// Position of the EOL ending the line before, at the '\r' of a "\r\n"
+static Sci_Position prevLineEnd(Sci_Position line, Accessor &styler) {
+    Sci_Position pos = styler.LineStart(line) - 1;
+    if (styler.SafeGetCharAt(pos) == '\n' && styler.SafeGetCharAt(pos - 1) == '\r') {
+        pos--;
+    }
+    return pos;
+}
+
+static bool startsInHereDoc(Sci_Position line, Accessor &styler) {
+    return line > 0 && actual_style(styler.StyleAt(prevLineEnd(line, styler))) == SCE_RB_HERE_Q;
+}
+
+static LineStartKind classifyLineStart(Sci_Position line,
+                                       Accessor &styler,
+                                       bool skipWhiteSpace) {
+    if (styler.LineStart(line) - 1 <= 10) {
+        return lineNearDocStart;
+    }
+    // Now look at the style before the previous line's EOL
+    Sci_Position pos = prevLineEnd(line, styler);
+    if (styler.SafeGetCharAt(pos - 1) == '\\') {
+        // Continuation line -- keep going
+    } else if (actual_style(styler.StyleAt(pos)) != SCE_RB_DEFAULT) {
+        // Part of multi-line construct -- keep going
+    } else if (currLineContainsHereDelims(pos, styler)) {
+        // Keep going
+    } else if (skipWhiteSpace && isEmptyLine(pos, styler)) {
+        // Keep going
+    } else {
+        return lineStartable;
+    }
+    return lineContinued;
+}
+
+// Walking back to a line that lexing can start from is remembered in the line
+// state of each line styled, so that restarting inside a long construct is not
+// proportional to its length:
+//   n > 0   lexing restarts from line n - 1
+//   n < 0   the line is inside the body of a here-doc opened on line -n - 1
+//   0       not known
+static void rememberDocStarts(Sci_Position lineFirst,
+                              Sci_Position lineLast,
+                              Accessor &styler) {
+    styler.Flush();
+    Sci_Position lineRestart = -1;
+    for (Sci_Position line = lineFirst; line <= lineLast; line++) {
+        switch (classifyLineStart(line, styler, false)) {
+        case lineStartable:
+            lineRestart = line;
+            break;
+        case lineContinued:
+            break;
+        case lineNearDocStart:
+            lineRestart = 0;
+            break;
+        }
+        int lineState = 0;
+        if (startsInHereDoc(line, styler)) {
+            Sci_Position lineOpener = line - 1;
+            if (startsInHereDoc(lineOpener, styler)) {
+                const int statePrev = styler.GetLineState(lineOpener);
+                lineOpener = (statePrev < 0) ? -statePrev - 1 : -1;
+            }
+            if (lineOpener >= 0) {
+                lineState = static_cast<int>(-lineOpener - 1);
+                const int stateOpener = styler.GetLineState(lineOpener);
+                if (lineRestart < 0 && stateOpener > 0) {
+                    lineRestart = stateOpener - 1;
+                }
+            }
+        }
+        if (lineState == 0 && lineRestart >= 0) {
+            lineState = static_cast<int>(lineRestart + 1);
+        }
+        styler.SetLineState(line, lineState);
+    }
+}
+
+// The line that opened the here-doc whose body contains the line starting at pos, or -1
+static Sci_Position hereDocOpenerAt(Sci_PositionU pos, Accessor &styler) {
+    const Sci_Position line = styler.GetLine(pos);
+    const int lineState = styler.GetLineState(line);
+    if (lineState < 0 && static_cast<Sci_PositionU>(styler.LineStart(line)) == pos
+            && -lineState - 1 < line
+            && startsInHereDoc(line, styler)) {
+        return -lineState - 1;
+    }
+    return -1;
+}
+
 //todo: if we aren't looking at a stdio character,
 // move to the start of the first line that is not in a
 // multi-line construct
@@ -660,30 +758,23 @@ static void synchronizeDocStart(Sci_PositionU &startPos,
 
     Sci_Position pos = startPos;
     // Quick way to characterize each line
-    Sci_Position lineStart;
-    for (lineStart = styler.GetLine(pos); lineStart > 0; lineStart--) {
-        // Now look at the style before the previous line's EOL
-        pos = styler.LineStart(lineStart) - 1;
-        if (pos <= 10) {
-            lineStart = 0;
-            break;
-        }
-        char ch = styler.SafeGetCharAt(pos);
-        char chPrev = styler.SafeGetCharAt(pos - 1);
-        if (ch == '\n' && chPrev == '\r') {
-            pos--;
-        }
-        if (styler.SafeGetCharAt(pos - 1) == '\\') {
-            // Continuation line -- keep going
-        } else if (actual_style(styler.StyleAt(pos)) != SCE_RB_DEFAULT) {
-            // Part of multi-line construct -- keep going
-        } else if (currLineContainsHereDelims(pos, styler)) {
-            // Keep going, with pos and length now pointing
-            // at the end of the here-doc delimiter
-        } else if (skipWhiteSpace && isEmptyLine(pos, styler)) {
-            // Keep going
-        } else {
-            break;
+    Sci_Position lineStart = styler.GetLine(pos);
+    int lineState = skipWhiteSpace ? 0 : styler.GetLineState(lineStart);
+    if (lineState < 0) {
+        const Sci_Position lineOpener = -lineState - 1;
+        lineState = (lineOpener < lineStart) ? styler.GetLineState(lineOpener) : 0;
+    }
+    if (lineState > 0 && lineState - 1 <= lineStart) {
+        lineStart = lineState - 1;
+    } else {
+        for (; lineStart > 0; lineStart--) {
+            const LineStartKind kind = classifyLineStart(lineStart, styler, skipWhiteSpace);
+            if (kind == lineNearDocStart) {
+                lineStart = 0;
+                break;
+            } else if (kind == lineStartable) {
+                break;
+            }
         }
     }
     pos = styler.LineStart(lineStart);
@@ -728,8 +819,17 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
     int numDots = 0;  // For numbers --
     // Don't start lexing in the middle of a num
 
+    // When starting inside the body of a here-doc, go back to the line that
+    // opened it to find the delimiter, then skip the part of the body that was
+    // styled before.
+    Sci_Position lineHereDocOpener = hereDocOpenerAt(startPos, styler);
+    const Sci_PositionU startPosResume = startPos;
+    Sci_Position lineSkippedFrom = -1;
+    Sci_Position lineSkippedTo = -1;
+
     synchronizeDocStart(startPos, length, initStyle, styler, // ref args
                         false);
+    const Sci_Position lineFirst = styler.GetLine(startPos);
 
     bool preferRE = true;
     int state = initStyle;
@@ -814,6 +914,25 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
             // Don't check for a missing quote, just jump into
             // the here-doc state
             state = SCE_RB_HERE_Q;
+            if (lineHereDocOpener == styler.GetLine(i)) {
+                lineHereDocOpener = -1;
+                // An empty delimiter matches at every line start and a lead byte
+                // swallows the EOL after it, so only skip over ordinary bodies
+                if (startPosResume - 1 > static_cast<Sci_PositionU>(i)
+                        && HereDoc.DelimiterLength > 0
+                        && !styler.IsLeadByte(styler.SafeGetCharAt(startPosResume - 2))) {
+                    styler.Flush();
+                    lineSkippedFrom = styler.GetLine(i);
+                    i = startPosResume - 1;
+                    lineSkippedTo = styler.GetLine(startPosResume);
+                    styler.StartAt(i);
+                    styler.StartSegment(i);
+                    chPrev = styler.SafeGetCharAt(i - 1);
+                    ch = styler.SafeGetCharAt(i);
+                    chNext = styler.SafeGetCharAt(i + 1);
+                    chNext2 = styler.SafeGetCharAt(i + 2);
+                }
+            }
         }
 
         // Regular transitions
@@ -1482,6 +1601,12 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
     } else {
         styler.ColourTo(lengthDoc - 1, state);
     }
+    if (lineSkippedTo >= 0) {
+        rememberDocStarts(lineFirst, lineSkippedFrom, styler);
+        rememberDocStarts(lineSkippedTo, styler.GetLine(lengthDoc), styler);
+    } else {
+        rememberDocStarts(lineFirst, styler.GetLine(lengthDoc), styler);
+    }
 }
 
 // Helper functions for folding, disambiguation keywords
@@ -1764,6 +1889,7 @@ static void FoldRbDoc(Sci_PositionU startPos, Sci_Position length, int initStyle
                       WordList *[], Accessor &styler) {
     const bool foldCompact = styler.GetPropertyInt("fold.compact", 1) != 0;
     bool foldComment = styler.GetPropertyInt("fold.comment") != 0;
+    const Sci_Position lineResume = styler.GetLine(startPos);
 
     synchronizeDocStart(startPos, length, initStyle, styler, // ref args
                         false);
@@ -1852,6 +1978,22 @@ static void FoldRbDoc(Sci_PositionU startPos, Sci_Position length, int initStyle
             levelPrev = levelCurrent;
             visibleChars = 0;
             buffer_ends_with_eol = true;
+            // Lines wholly inside a here-doc body before where folding was asked
+            // to start keep their level, so skip them while it is unchanged
+            if (lineCurrent < lineResume && startsInHereDoc(lineCurrent, styler)) {
+                const Sci_Position lineSkipFrom = lineCurrent;
+                while (lineCurrent < lineResume
+                        && startsInHereDoc(lineCurrent + 1, styler)
+                        && !(foldComment && IsCommentLine(lineCurrent, styler))
+                        && (styler.LevelAt(lineCurrent) & ~SC_FOLDLEVELWHITEFLAG) == (levelPrev | SC_FOLDLEVELBASE)) {
+                    lineCurrent++;
+                }
+                if (lineCurrent > lineSkipFrom) {
+                    i = styler.LineStart(lineCurrent) - 1;
+                    chNext = styler.SafeGetCharAt(i + 1);
+                    styleNext = styler.StyleAt(i + 1);
+                }
+            }
         } else if (!isspacechar(ch)) {
             visibleChars++;
             buffer_ends_with_eol = false;
@@ -99,11 +99,11 @@ static inline bool IsATADS3Operator(const int ch) {
 }
 
 static inline bool IsAWordChar(const int ch) {
-        return isalnum(ch) || ch == '_';
+        return IsASCII(ch) && (isalnum(ch) || ch == '_');
 }
 
 static inline bool IsAWordStart(const int ch) {
-        return isalpha(ch) || ch == '_';
+        return IsASCII(ch) && (isalpha(ch) || ch == '_');
 }
 
 static inline bool IsAHexDigit(const int ch) {
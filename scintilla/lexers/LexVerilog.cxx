@@ -14,6 +14,7 @@
 #include <ctype.h>
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <algorithm>
@@ -9,6 +9,9 @@
 
 #include <algorithm>
 #include <iterator>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "CharacterCategory.h"
 
@@ -3687,18 +3690,74 @@ const int maskCategory = 0x1F;
 // The value is comprised of a 21-bit character value shifted 5 bits and a 5 bit
 // category matching the CharacterCategory enumeration.
 // Initial version has 3249 entries and adds about 13K to the executable.
-// The array is in ascending order so can be searched using binary search.
-// Therefore the average call takes log2(3249) = 12 comparisons.
-// For speed, it may be useful to make a linear table for the common values,
-// possibly for 0..0xff for most Western European text or 0..0xfff for most
-// alphabetic languages.
+// The array is in ascending order so is only used to build CategoryTable.
+
+namespace {
+
+// Two stage lookup table expanded from catRanges on first use.
+// The code space is divided into blocks of 256 characters. The first stage maps
+// each block to a block of categories in the second stage and identical blocks
+// are shared so there are only around 130 distinct blocks taking about 42K in total.
+// Each lookup is then 2 array accesses instead of a 12 step binary search.
+class CategoryTable {
+	static constexpr int blockShift = 8;
+	static constexpr int blockSize = 1 << blockShift;
+	static constexpr int blockMask = blockSize - 1;
+	static constexpr int blockCount = (maxUnicode + 1) >> blockShift;
+	unsigned short blockStarts[blockCount];
+	std::vector<unsigned char> categories;
+public:
+	CategoryTable() {
+		unsigned char block[blockSize];
+		std::map<std::string, unsigned short> blockFromContents;
+		size_t range = 0;
+		for (int b = 0; b < blockCount; b++) {
+			const int blockStart = b << blockShift;
+			for (int i = 0; i < blockSize; i++) {
+				const int character = blockStart + i;
+				while ((range + 1 < std::size(catRanges)) && ((catRanges[range + 1] >> 5) <= character))
+					range++;
+				block[i] = static_cast<unsigned char>(catRanges[range] & maskCategory);
+			}
+			const std::string contents(reinterpret_cast<const char *>(block), blockSize);
+			const auto it = blockFromContents.find(contents);
+			if (it != blockFromContents.end()) {
+				blockStarts[b] = it->second;
+			} else {
+				const unsigned short index = static_cast<unsigned short>(blockFromContents.size());
+				blockFromContents[contents] = index;
+				blockStarts[b] = index;
+				categories.insert(categories.end(), block, block + blockSize);
+			}
+		}
+	}
+	CharacterCategory Category(int character) const noexcept {
+		const size_t start = static_cast<size_t>(blockStarts[character >> blockShift]) << blockShift;
+		return static_cast<CharacterCategory>(categories[start + (character & blockMask)]);
+	}
+};
+
+// Categories of ASCII characters are fixed so avoid the static guard for them.
+const unsigned char asciiCategories[] = {
+	ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc,
+	ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc, ccCc,
+	ccZs, ccPo, ccPo, ccPo, ccSc, ccPo, ccPo, ccPo, ccPs, ccPe, ccPo, ccSm, ccPo, ccPd, ccPo, ccPo,
+	ccNd, ccNd, ccNd, ccNd, ccNd, ccNd, ccNd, ccNd, ccNd, ccNd, ccPo, ccPo, ccSm, ccSm, ccSm, ccPo,
+	ccPo, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu,
+	ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccLu, ccPs, ccPo, ccPe, ccSk, ccPc,
+	ccSk, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl,
+	ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccLl, ccPs, ccSm, ccPe, ccSm, ccCc,
+};
+
+}
 
 CharacterCategory CategoriseCharacter(int character) {
 	if (character < 0 || character > maxUnicode)
 		return ccCn;
-	const int baseValue = character * (maskCategory+1) + maskCategory;
-	const int *placeAfter = std::lower_bound(catRanges, std::end(catRanges), baseValue);
-	return static_cast<CharacterCategory>(*(placeAfter-1) & maskCategory);
+	if (character < 0x80)
+		return static_cast<CharacterCategory>(asciiCategories[character]);
+	static const CategoryTable table;
+	return table.Category(character);
 }
 
 // Implementation of character sets recommended for identifiers in Unicode Standard Annex #31.
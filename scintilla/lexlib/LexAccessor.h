@@ -105,6 +105,11 @@ public:
 		}
 		return true;
 	}
+	/** Copy the text from startPos_ up to endPos_ into s in one call and terminate it with NUL. */
+	void GetRange(Sci_Position startPos_, Sci_Position endPos_, char *s) const {
+		pAccess->GetCharRange(s, startPos_, endPos_ - startPos_);
+		s[endPos_ - startPos_] = '\0';
+	}
 	char StyleAt(Sci_Position position) const {
 		return pAccess->StyleAt(position);
 	}
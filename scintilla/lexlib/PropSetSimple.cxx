@@ -12,6 +12,7 @@
 
 #include <string>
 #include <map>
+#include <utility>
 
 #include "PropSetSimple.h"
 
@@ -19,30 +20,39 @@ using namespace Scintilla;
 
 namespace {
 
-typedef std::map<std::string, std::string> mapss;
+typedef std::map<std::string, std::string, std::less<>> mapss;
 
-mapss *PropsFromPointer(void *impl) {
-	return static_cast<mapss *>(impl);
+// Lexers query the same few integer options on every call so the expanded and
+// converted values are remembered until any property changes.
+struct PropsWithIntCache : public mapss {
+	// Whether the property has a value and what that value converts to
+	std::map<std::string, std::pair<bool, int>, std::less<>> ints;
+};
+
+PropsWithIntCache *PropsFromPointer(void *impl) {
+	return static_cast<PropsWithIntCache *>(impl);
 }
 
 }
 
 PropSetSimple::PropSetSimple() {
-	mapss *props = new mapss;
+	PropsWithIntCache *props = new PropsWithIntCache;
 	impl = static_cast<void *>(props);
 }
 
 PropSetSimple::~PropSetSimple() {
-	mapss *props = PropsFromPointer(impl);
+	PropsWithIntCache *props = PropsFromPointer(impl);
 	delete props;
 	impl = 0;
 }
 
 void PropSetSimple::Set(const char *key, const char *val, size_t lenKey, size_t lenVal) {
-	mapss *props = PropsFromPointer(impl);
+	PropsWithIntCache *props = PropsFromPointer(impl);
 	if (!*key)	// Empty keys are not supported
 		return;
 	(*props)[std::string(key, lenKey)] = std::string(val, lenVal);
+	// Values may be expanded from other properties so forget them all
+	props->ints.clear();
 }
 
 static bool IsASpaceCharacter(unsigned int ch) {
@@ -76,7 +86,7 @@ void PropSetSimple::SetMultiple(const char *s) {
 
 const char *PropSetSimple::Get(const char *key) const {
 	mapss *props = PropsFromPointer(impl);
-	mapss::const_iterator keyPos = props->find(std::string(key));
+	mapss::const_iterator keyPos = props->find(key);
 	if (keyPos != props->end()) {
 		return keyPos->second.c_str();
 	} else {
@@ -148,10 +158,12 @@ int PropSetSimple::GetExpanded(const char *key, char *result) const {
 }
 
 int PropSetSimple::GetInt(const char *key, int defaultValue) const {
-	std::string val = Get(key);
-	ExpandAllInPlace(*this, val, 100, VarChain(key));
-	if (!val.empty()) {
-		return atoi(val.c_str());
+	PropsWithIntCache *props = PropsFromPointer(impl);
+	std::map<std::string, std::pair<bool, int>, std::less<>>::const_iterator it = props->ints.find(key);
+	if (it == props->ints.end()) {
+		std::string val = Get(key);
+		ExpandAllInPlace(*this, val, 100, VarChain(key));
+		it = props->ints.emplace(key, std::make_pair(!val.empty(), atoi(val.c_str()))).first;
 	}
-	return defaultValue;
+	return it->second.first ? it->second.second : defaultValue;
 }
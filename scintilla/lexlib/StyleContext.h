@@ -139,6 +139,18 @@ public:
 			}
 		}
 	}
+	// Move to a later position on the current line without visiting the characters
+	// in between. The character before pos must be a single byte.
+	void SkipTo(Sci_PositionU pos) {
+		atLineStart = false;
+		chPrev = static_cast<unsigned char>(styler.SafeGetCharAt(pos - 1, 0));
+		currentPos = pos;
+		width = 0;
+		GetNextChar();
+		ch = chNext;
+		width = widthNext;
+		GetNextChar();
+	}
 	void ChangeState(int state_) {
 		state = state_;
 	}
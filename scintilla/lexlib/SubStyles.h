@@ -10,11 +10,91 @@
 
 namespace Scintilla {
 
+// Open addressed hash from identifier to style. Words are stored end to end in one
+// string so lookups by string_view neither allocate nor chase per-word pointers.
+class WordStyleTable {
+	struct Slot {
+		unsigned int hash;
+		unsigned int start;
+		unsigned int length;	// 0 marks an empty slot
+		int style;
+	};
+	std::string words;
+	std::vector<Slot> slots;
+	size_t used;
+
+	static unsigned int Hash(std::string_view sv) noexcept {
+		unsigned int h = 2166136261U;
+		for (const char ch : sv) {
+			h = (h ^ static_cast<unsigned char>(ch)) * 16777619U;
+		}
+		return h;
+	}
+
+	size_t Find(std::string_view sv, unsigned int h) const noexcept {
+		const size_t mask = slots.size() - 1;
+		size_t i = h & mask;
+		while (slots[i].length) {
+			if ((slots[i].hash == h) && (slots[i].length == sv.length()) &&
+				(words.compare(slots[i].start, slots[i].length, sv) == 0))
+				return i;
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
+
+	void Grow() {
+		std::vector<Slot> old(slots.empty() ? 16 : slots.size() * 2, Slot{0, 0, 0, 0});
+		old.swap(slots);
+		const size_t mask = slots.size() - 1;
+		for (const Slot &slot : old) {
+			if (slot.length) {
+				size_t i = slot.hash & mask;
+				while (slots[i].length)
+					i = (i + 1) & mask;
+				slots[i] = slot;
+			}
+		}
+	}
+
+public:
+	WordStyleTable() : used(0) {
+	}
+
+	void Clear() {
+		words.clear();
+		slots.clear();
+		used = 0;
+	}
+
+	void Set(std::string_view sv, int style) {
+		if ((used + 1) * 4 > slots.size() * 3)
+			Grow();
+		const unsigned int h = Hash(sv);
+		Slot &slot = slots[Find(sv, h)];
+		if (!slot.length) {
+			slot.hash = h;
+			slot.start = static_cast<unsigned int>(words.length());
+			slot.length = static_cast<unsigned int>(sv.length());
+			words.append(sv);
+			used++;
+		}
+		slot.style = style;
+	}
+
+	int Get(std::string_view sv) const noexcept {
+		if (used == 0 || sv.empty())
+			return -1;
+		const Slot &slot = slots[Find(sv, Hash(sv))];
+		return slot.length ? slot.style : -1;
+	}
+};
+
 class WordClassifier {
 	int baseStyle;
 	int firstStyle;
 	int lenStyles;
-	std::map<std::string, int> wordToStyle;
+	WordStyleTable wordToStyle;
 
 public:
 
@@ -24,7 +104,7 @@ public:
 	void Allocate(int firstStyle_, int lenStyles_) {
 		firstStyle = firstStyle_;
 		lenStyles = lenStyles_;
-		wordToStyle.clear();
+		wordToStyle.Clear();
 	}
 
 	int Base() const {
@@ -46,15 +126,11 @@ public:
 	void Clear() {
 		firstStyle = 0;
 		lenStyles = 0;
-		wordToStyle.clear();
+		wordToStyle.Clear();
 	}
 
-	int ValueFor(const std::string &s) const {
-		std::map<std::string, int>::const_iterator it = wordToStyle.find(s);
-		if (it != wordToStyle.end())
-			return it->second;
-		else
-			return -1;
+	int ValueFor(std::string_view s) const noexcept {
+		return wordToStyle.Get(s);
 	}
 
 	bool IncludesStyle(int style) const {
@@ -67,8 +143,7 @@ public:
 			while (*cpSpace && !(*cpSpace == ' ' || *cpSpace == '\t' || *cpSpace == '\r' || *cpSpace == '\n'))
 				cpSpace++;
 			if (cpSpace > identifiers) {
-				std::string word(identifiers, cpSpace - identifiers);
-				wordToStyle[word] = style;
+				wordToStyle.Set(std::string_view(identifiers, cpSpace - identifiers), style);
 			}
 			identifiers = cpSpace;
 			if (*identifiers)
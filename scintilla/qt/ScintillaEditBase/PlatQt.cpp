@@ -10,6 +10,8 @@
 
 #include <cstdio>
 
+#include <algorithm>
+
 #include "PlatQt.h"
 #include "Scintilla.h"
 #include "UniConversion.h"
@@ -36,6 +38,8 @@
 #include <QDesktopWidget>
 #include <QTextLayout>
 #include <QTextLine>
+#include <QGlyphRun>
+#include <QFontInfo>
 #include <QLibrary>
 
 namespace Scintilla {
@@ -101,8 +105,12 @@ class FontAndCharacterSet {
 public:
 	int characterSet;
 	QFont *pfont;
+	// Advances of ASCII characters when the font is fixed pitch, measured
+	// for the resolution advancesDpi.
+	int advancesDpi;
+	std::vector<qreal> asciiAdvances;
 	FontAndCharacterSet(int characterSet_, QFont *pfont):
-		characterSet(characterSet_), pfont(pfont) {
+		characterSet(characterSet_), pfont(pfont), advancesDpi(0) {
 	}
 	~FontAndCharacterSet() {
 		delete pfont;
@@ -118,6 +126,80 @@ static QFont *FontPointer(Font &f)
 {
 	return reinterpret_cast<FontAndCharacterSet *>(f.GetID())->pfont;
 }
+
+// Fixed pitch fonts are measured once per resolution so that ASCII text can be
+// positioned without being laid out. Returns nullptr for proportional fonts.
+static const qreal *AsciiAdvances(Font &f, QPaintDevice *device)
+{
+	FontAndCharacterSet *pfcs = reinterpret_cast<FontAndCharacterSet *>(f.GetID());
+	const int dpi = device->logicalDpiX();
+	if (pfcs->advancesDpi != dpi) {
+		pfcs->advancesDpi = dpi;
+		pfcs->asciiAdvances.clear();
+		if (QFontInfo(*pfcs->pfont).fixedPitch()) {
+			QFontMetricsF metrics(*pfcs->pfont, device);
+			pfcs->asciiAdvances.resize(0x80);
+			for (int ch = 0x20; ch < 0x7f; ch++) {
+				pfcs->asciiAdvances[ch] = metrics.width(QChar(ch));
+			}
+		}
+	}
+	return pfcs->asciiAdvances.empty() ? nullptr : pfcs->asciiAdvances.data();
+}
+
+static bool IsPrintableASCII(std::string_view text)
+{
+	for (const char ch : text) {
+		if (ch < 0x20 || ch >= 0x7f)
+			return false;
+	}
+	return true;
+}
+
+// Text where each code unit is shaped into one glyph and glyphs are in logical order.
+static bool OneGlyphPerCodeUnit(const QString &su)
+{
+	for (const QChar ch : su) {
+		if (ch.isSurrogate() || ch.isMark())
+			return false;
+		switch (ch.direction()) {
+		case QChar::DirR:
+		case QChar::DirAL:
+		case QChar::DirRLE:
+		case QChar::DirRLO:
+			return false;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+// Fill cursors with the x position at each code unit boundary of su.
+// Calling cursorToX for each position rescans the line each time so, when the
+// text is simple, take the positions from the glyphs of the line in one pass.
+static void CursorPositions(const QTextLine &tl, const QString &su, std::vector<qreal> &cursors)
+{
+	const int length = su.size();
+	cursors.resize(length + 1);
+	cursors[0] = 0;
+	if (length > 1 && OneGlyphPerCodeUnit(su)) {
+		const QList<QGlyphRun> runs = tl.glyphRuns();
+		if (runs.size() == 1) {
+			const QVector<QPointF> glyphPositions = runs.first().positions();
+			if (glyphPositions.size() == length) {
+				for (int i=1; i<length; i++) {
+					cursors[i] = glyphPositions[i].x();
+				}
+				cursors[length] = tl.cursorToX(length);
+				return;
+			}
+		}
+	}
+	for (int i=1; i<=length; i++) {
+		cursors[i] = tl.cursorToX(i);
+	}
+}
 Font::Font() noexcept : fid(nullptr) {}
 Font::~Font()
 {
@@ -177,6 +259,7 @@ void SurfaceImpl::Clear()
 	painter = nullptr;
 	deviceOwned = false;
 	painterOwned = false;
+	measureLayout.reset();
 }
 
 void SurfaceImpl::Init(WindowID wid)
@@ -467,12 +550,30 @@ void SurfaceImpl::MeasureWidths(Font &font,
 {
 	if (!font.GetID())
 		return;
+	const qreal *asciiAdvances = AsciiAdvances(font, GetPaintDevice());
+	if (asciiAdvances && IsPrintableASCII(text)) {
+		qreal xPosition = 0;
+		for (size_t i=0; i<text.length(); i++) {
+			xPosition += asciiAdvances[static_cast<unsigned char>(text[i])];
+			positions[i] = xPosition;
+		}
+		return;
+	}
 	SetCodec(font);
 	QString su = UnicodeFromText(codec, text);
-	QTextLayout tlay(su, *FontPointer(font), GetPaintDevice());
-	tlay.beginLayout();
-	QTextLine tl = tlay.createLine();
-	tlay.endLayout();
+	// The layout is kept between calls to avoid allocating it for each segment
+	if (!measureLayout) {
+		measureLayout = std::make_unique<QTextLayout>(su, *FontPointer(font), GetPaintDevice());
+	} else {
+		measureLayout->setText(su);
+		measureLayout->setFont(*FontPointer(font));
+	}
+	measureLayout->beginLayout();
+	QTextLine tl = measureLayout->createLine();
+	measureLayout->endLayout();
+	CursorPositions(tl, su, measureCursors);
+	const std::vector<qreal> &cursors = measureCursors;
+	const int lastCursor = su.size();
 	if (unicodeMode) {
 		int fit = su.size();
 		int ui=0;
@@ -481,7 +582,7 @@ void SurfaceImpl::MeasureWidths(Font &font,
 			const unsigned char uch = text[i];
 			const unsigned int byteCount = UTF8BytesOfLead[uch];
 			const int codeUnits = UTF16LengthFromUTF8ByteCount(byteCount);
-			qreal xPosition = tl.cursorToX(ui+codeUnits);
+			qreal xPosition = cursors[std::min(ui+codeUnits, lastCursor)];
 			for (size_t bytePos=0; (bytePos<byteCount) && (i<text.length()); bytePos++) {
 				positions[i++] = xPosition;
 			}
@@ -498,7 +599,7 @@ void SurfaceImpl::MeasureWidths(Font &font,
 		int ui = 0;
 		for (size_t i=0; i<text.length();) {
 			size_t lenChar = DBCSIsLeadByte(codePage, text[i]) ? 2 : 1;
-			qreal xPosition = tl.cursorToX(ui+1);
+			qreal xPosition = cursors[std::min(ui+1, lastCursor)];
 			for (unsigned int bytePos=0; (bytePos<lenChar) && (i<text.length()); bytePos++) {
 				positions[i++] = xPosition;
 			}
@@ -507,7 +608,7 @@ void SurfaceImpl::MeasureWidths(Font &font,
 	} else {
 		// Single byte encoding
 		for (int i=0; i<static_cast<int>(text.length()); i++) {
-			positions[i] = tl.cursorToX(i+1);
+			positions[i] = cursors[std::min(i+1, lastCursor)];
 		}
 	}
 }
@@ -23,6 +23,7 @@
 #include <QPaintDevice>
 #include <QPainter>
 #include <QHash>
+#include <QTextLayout>
 
 namespace Scintilla {
 
@@ -70,6 +71,8 @@ private:
 	int codePage;
 	const char *codecName;
 	QTextCodec *codec;
+	std::unique_ptr<QTextLayout> measureLayout;
+	std::vector<qreal> measureCursors;
 
 	void Clear();
 
@@ -12,6 +12,7 @@
 #include <cstdarg>
 
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <algorithm>
@@ -361,11 +362,86 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
+namespace {
+
+// Snapshots copy changed text in pieces of this size so a small edit only copies
+// the pieces around it.
+constexpr Sci::Position snapshotChunkSize = 0x10000;
+
+// Older edits are discarded once the log is this long and snapshots or readers
+// that are further behind start again from the whole text.
+constexpr size_t editLogMaximum = 0x4000;
+
+}
+
+TextSnapshot::TextSnapshot(int version_) : version(version_) {
+	starts.push_back(0);
+}
+
+void TextSnapshot::AddChunk(const std::shared_ptr<const std::string> &chunk) {
+	chunks.push_back(chunk);
+	starts.push_back(starts.back() + chunk->length());
+}
+
+size_t TextSnapshot::ChunkFromPosition(Sci::Position position) const noexcept {
+	// starts is sorted and position is inside the text so there is always a chunk
+	const auto it = std::upper_bound(starts.begin(), starts.end(), position);
+	return it - starts.begin() - 1;
+}
+
+int TextSnapshot::Version() const noexcept {
+	return version;
+}
+
+Sci::Position TextSnapshot::Length() const noexcept {
+	return starts.back();
+}
+
+char TextSnapshot::CharAt(Sci::Position position) const noexcept {
+	if (position < 0 || position >= Length())
+		return '\0';
+	const size_t chunk = ChunkFromPosition(position);
+	return (*chunks[chunk])[position - starts[chunk]];
+}
+
+void TextSnapshot::GetCharRange(char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const {
+	if (lengthRetrieve <= 0)
+		return;
+	if (position < 0)
+		return;
+	if ((position + lengthRetrieve) > Length()) {
+		Platform::DebugPrintf("Bad GetCharRange %d for %d of %d\n", position,
+		                      lengthRetrieve, Length());
+		return;
+	}
+	size_t chunk = ChunkFromPosition(position);
+	while (lengthRetrieve > 0) {
+		const Sci::Position offset = position - starts[chunk];
+		const Sci::Position lengthPart = std::min(lengthRetrieve, starts[chunk + 1] - position);
+		memcpy(buffer, chunks[chunk]->data() + offset, lengthPart);
+		buffer += lengthPart;
+		position += lengthPart;
+		lengthRetrieve -= lengthPart;
+		chunk++;
+	}
+}
+
+std::string TextSnapshot::Text() const {
+	std::string text;
+	text.reserve(Length());
+	for (const std::shared_ptr<const std::string> &chunk : chunks) {
+		text.append(*chunk);
+	}
+	return text;
+}
+
 CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
 	hasStyles(hasStyles_), largeDocument(largeDocument_) {
 	readOnly = false;
 	utf8LineEnds = 0;
 	collectingUndo = true;
+	version = 0;
+	editLogStart = 0;
 	if (largeDocument)
 		plv = std::make_unique<LineVector<Sci::Position>>();
 	else
@@ -648,10 +724,93 @@ void CellBuffer::ResetLineEnds() {
 	}
 }
 
+void CellBuffer::RecordEdit(Sci::Position position, Sci::Position lengthDeleted, Sci::Position lengthInserted) {
+	if (editLog.size() >= editLogMaximum) {
+		const size_t discard = editLog.size() / 2;
+		editLog.erase(editLog.begin(), editLog.begin() + discard);
+		editLogStart += static_cast<int>(discard);
+	}
+	editLog.emplace_back(position, lengthDeleted, lengthInserted);
+	version++;
+}
+
+int CellBuffer::Version() const noexcept {
+	return version;
+}
+
+std::shared_ptr<const TextSnapshot> CellBuffer::Snapshot() {
+	if (snapshotLast && (snapshotLast->Version() == version))
+		return snapshotLast;
+
+	const Sci::Position lengthText = Length();
+	std::shared_ptr<TextSnapshot> snapshot = std::make_shared<TextSnapshot>(version);
+
+	// Work out how much of the start and end of the previous snapshot is unchanged
+	const TextSnapshot *previous = nullptr;
+	Sci::Position prefix = 0;
+	Sci::Position suffix = 0;
+	if (snapshotLast && (snapshotLast->Version() >= editLogStart)) {
+		previous = snapshotLast.get();
+		prefix = previous->Length();
+		suffix = previous->Length();
+		Sci::Position lengthBefore = previous->Length();
+		for (size_t i = previous->Version() - editLogStart; i < editLog.size(); i++) {
+			const TextEdit &edit = editLog[i];
+			prefix = std::min(prefix, edit.position);
+			suffix = std::min(suffix, lengthBefore - edit.position - edit.lengthDeleted);
+			lengthBefore += edit.lengthInserted - edit.lengthDeleted;
+		}
+	}
+
+	// Share whole chunks inside the unchanged prefix and suffix and copy the rest
+	size_t chunkPrefix = 0;
+	size_t chunkSuffix = 0;
+	Sci::Position startSuffix = lengthText;
+	if (previous) {
+		while ((chunkPrefix < previous->chunks.size()) && (previous->starts[chunkPrefix + 1] <= prefix)) {
+			chunkPrefix++;
+		}
+		const Sci::Position lengthPrevious = previous->Length();
+		chunkSuffix = previous->chunks.size();
+		while ((chunkSuffix > chunkPrefix) && (previous->starts[chunkSuffix - 1] >= lengthPrevious - suffix)) {
+			chunkSuffix--;
+		}
+		startSuffix = lengthText - (lengthPrevious - previous->starts[chunkSuffix]);
+		for (size_t chunk = 0; chunk < chunkPrefix; chunk++) {
+			snapshot->AddChunk(previous->chunks[chunk]);
+		}
+	}
+	Sci::Position position = snapshot->Length();
+	while (position < startSuffix) {
+		const Sci::Position lengthChunk = std::min(snapshotChunkSize, startSuffix - position);
+		std::shared_ptr<std::string> text = std::make_shared<std::string>(lengthChunk, '\0');
+		substance.GetRange(&(*text)[0], position, lengthChunk);
+		snapshot->AddChunk(text);
+		position += lengthChunk;
+	}
+	if (previous) {
+		for (size_t chunk = chunkSuffix; chunk < previous->chunks.size(); chunk++) {
+			snapshot->AddChunk(previous->chunks[chunk]);
+		}
+	}
+	PLATFORM_ASSERT(snapshot->Length() == lengthText);
+
+	snapshotLast = snapshot;
+	return snapshotLast;
+}
+
+bool CellBuffer::EditsSince(int versionSince, std::vector<TextEdit> &edits) const {
+	if ((versionSince < editLogStart) || (versionSince > version))
+		return false;
+	edits.insert(edits.end(), editLog.begin() + (versionSince - editLogStart), editLog.end());
+	return true;
+}
+
 void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::Position insertLength) {
 	if (insertLength == 0)
 		return;
 	PLATFORM_ASSERT(insertLength > 0);
+	RecordEdit(position, 0, insertLength);
 
 	const unsigned char chAfter = substance.ValueAt(position);
 	bool breakingUTF8LineEnd = false;
@@ -730,6 +889,7 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLength) {
 	if (deleteLength == 0)
 		return;
+	RecordEdit(position, deleteLength, 0);
 
 	if ((position == 0) && (deleteLength == substance.Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
@@ -49,6 +49,41 @@ public:
 	void Clear();
 };
 
+/**
+ * A change to the text where lengthDeleted bytes at position were replaced by lengthInserted bytes.
+ */
+struct TextEdit {
+	Sci::Position position;
+	Sci::Position lengthDeleted;
+	Sci::Position lengthInserted;
+	TextEdit(Sci::Position position_, Sci::Position lengthDeleted_, Sci::Position lengthInserted_) noexcept :
+		position(position_), lengthDeleted(lengthDeleted_), lengthInserted(lengthInserted_) {
+	}
+};
+
+/**
+ * An immutable copy of the text of a CellBuffer at one version.
+ * The text is held in shared chunks so snapshots of nearby versions share the chunks
+ * that were not edited. Snapshots may be read from any thread while the buffer changes.
+ */
+class TextSnapshot {
+	int version;
+	std::vector<std::shared_ptr<const std::string>> chunks;
+	// Start position of each chunk followed by the total length
+	std::vector<Sci::Position> starts;
+	friend class CellBuffer;
+	void AddChunk(const std::shared_ptr<const std::string> &chunk);
+	size_t ChunkFromPosition(Sci::Position position) const noexcept;
+public:
+	explicit TextSnapshot(int version_);
+	int Version() const noexcept;
+	Sci::Position Length() const noexcept;
+	/// Retrieving positions outside the range of the snapshot works and returns 0
+	char CharAt(Sci::Position position) const noexcept;
+	void GetCharRange(char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const;
+	std::string Text() const;
+};
+
 /**
  *
  */
@@ -120,6 +155,14 @@ private:
 
 	std::unique_ptr<ILineVector> plv;
 
+	/// Incremented for each change to the text so readers can tell what they have seen.
+	int version;
+	/// editLog[i] changed the text from version editLogStart+i to editLogStart+i+1.
+	int editLogStart;
+	std::vector<TextEdit> editLog;
+	std::shared_ptr<const TextSnapshot> snapshotLast;
+
+	void RecordEdit(Sci::Position position, Sci::Position lengthDeleted, Sci::Position lengthInserted);
 	bool UTF8LineEndOverlaps(Sci::Position position) const;
 	void ResetLineEnds();
 	/// Actions without undo
@@ -166,6 +209,13 @@ public:
 
 	const char *DeleteChars(Sci::Position position, Sci::Position deleteLength, bool &startSequence);
 
+	int Version() const noexcept;
+	/// Returns an immutable copy of the current text, sharing unchanged chunks with the previous one.
+	std::shared_ptr<const TextSnapshot> Snapshot();
+	/// Appends the changes made after versionSince to edits.
+	/// @return false if versionSince is too old for the changes to still be known.
+	bool EditsSince(int versionSince, std::vector<TextEdit> &edits) const;
+
 	bool IsReadOnly() const;
 	void SetReadOnly(bool set);
 	bool IsLarge() const;
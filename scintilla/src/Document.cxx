@@ -49,6 +49,13 @@
 
 using namespace Scintilla;
 
+namespace {
+
+// Scans read text in blocks of this size instead of a byte at a time.
+constexpr Sci::Position scanBlockSize = 1024;
+
+}
+
 void LexInterface::Colourise(Sci::Position start, Sci::Position end) {
 	if (pdoc && instance && !performingStyle) {
 		// Protect against reentrance, which may occur, for example, when
@@ -108,6 +115,10 @@ Document::Document(int options) :
 	backspaceUnindents = false;
 	durationStyleOneLine = 0.00001;
 
+	indentationCacheLine = 0;
+	indentationCacheVersion = -1;
+	indentationCacheTabInChars = 0;
+
 	matchesValid = false;
 
 	perLineData[ldMarkers] = std::make_unique<LineMarkers>();
@@ -1240,6 +1251,32 @@ void * SCI_METHOD Document::ConvertToDocument() {
 	return this;
 }
 
+namespace {
+
+// Holds a reference to a snapshot for a container that only sees ITextSnapshot.
+class DocumentSnapshot final : public ITextSnapshot {
+	std::shared_ptr<const TextSnapshot> snapshot;
+public:
+	explicit DocumentSnapshot(std::shared_ptr<const TextSnapshot> snapshot_) : snapshot(std::move(snapshot_)) {
+	}
+	int SCI_METHOD Release() override {
+		delete this;
+		return 0;
+	}
+	Sci_Position SCI_METHOD Length() const override {
+		return snapshot->Length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const override {
+		snapshot->GetCharRange(buffer, position, lengthRetrieve);
+	}
+};
+
+}
+
+ITextSnapshot *Document::CreateTextSnapshot() {
+	return new DocumentSnapshot(cb.Snapshot());
+}
+
 Sci::Position Document::Undo() {
 	Sci::Position newPos = -1;
 	CheckReadOnly();
@@ -1422,21 +1459,7 @@ static std::string CreateIndentation(Sci::Position indent, int tabSize, bool ins
 }
 
 int SCI_METHOD Document::GetLineIndentation(Sci_Position line) {
-	int indent = 0;
-	if ((line >= 0) && (line < LinesTotal())) {
-		const Sci::Position lineStart = LineStart(line);
-		const Sci::Position length = Length();
-		for (Sci::Position i = lineStart; i < length; i++) {
-			const char ch = cb.CharAt(i);
-			if (ch == ' ')
-				indent++;
-			else if (ch == '\t')
-				indent = static_cast<int>(NextTab(indent, tabInChars));
-			else
-				return indent;
-		}
-	}
-	return indent;
+	return IndentationOfLine(line).indent;
 }
 
 Sci::Position Document::SetLineIndentation(Sci::Line line, Sci::Position indent) {
@@ -1457,14 +1480,94 @@ Sci::Position Document::SetLineIndentation(Sci::Line line, Sci::Position indent)
 }
 
 Sci::Position Document::GetLineIndentPosition(Sci::Line line) const {
-	if (line < 0)
-		return 0;
-	Sci::Position pos = LineStart(line);
-	const Sci::Position length = Length();
-	while ((pos < length) && IsSpaceOrTab(cb.CharAt(pos))) {
-		pos++;
+	return IndentationOfLine(line).position;
+}
+
+/**
+ * Measure the indentation of lines [lineFirst, lineLast) into indentations.
+ * The text is read in blocks that span many short lines and each line's leading
+ * spaces and tabs are scanned directly in the block.
+ */
+void Document::GetLinesIndentation(Sci::Line lineFirst, Sci::Line lineLast, LineIndentation *indentations) const {
+	lineLast = std::min(lineLast, LinesTotal());
+	if (lineFirst >= lineLast)
+		return;
+	const Sci::Position endRange = LineStart(lineLast);
+	char buffer[scanBlockSize];
+	Sci::Position startBlock = 0;
+	Sci::Position endBlock = 0;
+	for (Sci::Line line = lineFirst; line < lineLast; line++) {
+		const Sci::Position lineEnd = LineEnd(line);
+		Sci::Position pos = LineStart(line);
+		int indent = 0;
+		while (pos < lineEnd) {
+			if ((pos < startBlock) || (pos >= endBlock)) {
+				startBlock = pos;
+				endBlock = std::min(pos + scanBlockSize, std::max(endRange, lineEnd));
+				cb.GetCharRange(buffer, startBlock, endBlock - startBlock);
+			}
+			const char *p = buffer + (pos - startBlock);
+			const char *end = buffer + (std::min(lineEnd, endBlock) - startBlock);
+			while ((p < end) && IsSpaceOrTab(*p)) {
+				if (*p == ' ')
+					indent++;
+				else
+					indent = static_cast<int>(NextTab(indent, tabInChars));
+				p++;
+			}
+			pos = startBlock + (p - buffer);
+			if (p < end)
+				break;
+		}
+		LineIndentation &indentation = indentations[line - lineFirst];
+		indentation.position = pos;
+		indentation.indent = indent;
+		indentation.white = pos >= lineEnd;
 	}
-	return pos;
+}
+
+LineIndentation Document::IndentationOfLine(Sci::Line line) const {
+	LineIndentation indentation;
+	if (line >= LinesTotal())
+		indentation.position = Length();
+	else if (line >= 0)
+		GetLinesIndentation(line, line + 1, &indentation);
+	return indentation;
+}
+
+/**
+ * Indentation of a line remembered from a block of lines around it so that drawing
+ * indentation guides does not repeatedly scan the same lines. The block is trimmed back
+ * to the lines before the first edit when the text changes.
+ */
+LineIndentation Document::CachedLineIndentation(Sci::Line line) {
+	constexpr Sci::Line linesCached = 128;
+	if ((line < 0) || (line >= LinesTotal()))
+		return IndentationOfLine(line);
+	if ((indentationCacheVersion != cb.Version()) || (indentationCacheTabInChars != tabInChars)) {
+		std::vector<TextEdit> edits;
+		if ((indentationCacheTabInChars == tabInChars) && cb.EditsSince(indentationCacheVersion, edits)) {
+			Sci::Position positionEdit = Length();
+			for (const TextEdit &edit : edits) {
+				positionEdit = std::min(positionEdit, edit.position);
+			}
+			const Sci::Line lineEdit = SciLineFromPosition(positionEdit);
+			const Sci::Line linesValid = std::clamp(lineEdit - indentationCacheLine,
+				static_cast<Sci::Line>(0), static_cast<Sci::Line>(indentationCache.size()));
+			indentationCache.resize(linesValid);
+		} else {
+			indentationCache.clear();
+		}
+		indentationCacheVersion = cb.Version();
+		indentationCacheTabInChars = tabInChars;
+	}
+	if ((line < indentationCacheLine) || (line >= indentationCacheLine + static_cast<Sci::Line>(indentationCache.size()))) {
+		indentationCacheLine = std::max(line - linesCached / 2, static_cast<Sci::Line>(0));
+		const Sci::Line lineEnd = std::min(indentationCacheLine + linesCached, LinesTotal());
+		indentationCache.resize(lineEnd - indentationCacheLine);
+		GetLinesIndentation(indentationCacheLine, lineEnd, indentationCache.data());
+	}
+	return indentationCache[line - indentationCacheLine];
 }
 
 Sci::Position Document::GetColumn(Sci::Position pos) {
@@ -1559,23 +1662,31 @@ void Document::Indent(bool forwards, Sci::Line lineBottom, Sci::Line lineTop) {
 // Convert line endings for a piece of text to a particular mode.
 // Stop at len or when a NUL is found.
 std::string Document::TransformLineEnds(const char *s, size_t len, int eolModeWanted) {
+	const char *eol = "\r\n";
+	if (eolModeWanted == SC_EOL_CR) {
+		eol = "\r";
+	} else if (eolModeWanted == SC_EOL_LF) {
+		eol = "\n";
+	}
+	const size_t lengthEOL = strlen(eol);
 	std::string dest;
-	for (size_t i = 0; (i < len) && (s[i]); i++) {
-		if (s[i] == '\n' || s[i] == '\r') {
-			if (eolModeWanted == SC_EOL_CR) {
-				dest.push_back('\r');
-			} else if (eolModeWanted == SC_EOL_LF) {
-				dest.push_back('\n');
-			} else { // eolModeWanted == SC_EOL_CRLF
-				dest.push_back('\r');
-				dest.push_back('\n');
-			}
-			if ((s[i] == '\r') && (i+1 < len) && (s[i+1] == '\n')) {
-				i++;
-			}
-		} else {
-			dest.push_back(s[i]);
+	dest.reserve(len);
+	size_t i = 0;
+	while (i < len) {
+		// Append each run of ordinary characters as a block
+		size_t end = i;
+		while ((end < len) && s[end] && (s[end] != '\n') && (s[end] != '\r')) {
+			end++;
+		}
+		dest.append(s + i, end - i);
+		if ((end >= len) || !s[end]) {
+			break;
 		}
+		dest.append(eol, lengthEOL);
+		if ((s[end] == '\r') && (end + 1 < len) && (s[end + 1] == '\n')) {
+			end++;
+		}
+		i = end + 1;
 	}
 	return dest;
 }
@@ -1624,15 +1735,7 @@ int Document::Options() const {
 }
 
 bool Document::IsWhiteLine(Sci::Line line) const {
-	Sci::Position currentChar = LineStart(line);
-	const Sci::Position endLine = LineEnd(line);
-	while (currentChar < endLine) {
-		if (!IsSpaceOrTab(cb.CharAt(currentChar))) {
-			return false;
-		}
-		++currentChar;
-	}
-	return true;
+	return IndentationOfLine(line).white;
 }
 
 Sci::Position Document::ParaUp(Sci::Position pos) const {
@@ -1732,6 +1835,101 @@ CharClassify::cc Document::WordCharacterClass(unsigned int ch) const {
 	return charClass.GetClass(static_cast<unsigned char>(ch));
 }
 
+/**
+ * Return the end of the run of characters starting at pos for which predicate is true.
+ * Text is copied out in blocks so that long runs are scanned at memory speed: ASCII bytes,
+ * and every byte in single byte encodings, are single characters and UTF-8 sequences
+ * inside the block are decoded in place. Other characters use CharacterAfter.
+ */
+template <typename Predicate>
+Sci::Position Document::ForwardWhile(Sci::Position pos, Predicate predicate) const {
+	const Sci::Position length = Length();
+	char buffer[scanBlockSize];
+	while (pos < length) {
+		const Sci::Position lengthBlock = std::min(scanBlockSize, length - pos);
+		cb.GetCharRange(buffer, pos, lengthBlock);
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(buffer);
+		Sci::Position i = 0;
+		while (i < lengthBlock) {
+			const unsigned char ch = bytes[i];
+			if (!dbcsCodePage || UTF8IsAscii(ch)) {
+				if (!predicate(ch))
+					return pos + i;
+				i++;
+			} else if ((SC_CP_UTF8 == dbcsCodePage) && (i + UTF8BytesOfLead[ch] <= lengthBlock)) {
+				const int utf8status = UTF8Classify(bytes + i, UTF8BytesOfLead[ch]);
+				if (utf8status & UTF8MaskInvalid) {
+					if (!predicate(unicodeReplacementChar))
+						return pos + i;
+					i++;
+				} else {
+					if (!predicate(UnicodeFromUTF8(bytes + i)))
+						return pos + i;
+					i += utf8status & UTF8MaskWidth;
+				}
+			} else {
+				const CharacterExtracted ce = CharacterAfter(pos + i);
+				if (!predicate(ce.character))
+					return pos + i;
+				i += ce.widthBytes;
+			}
+		}
+		// May be past the block when the last character continued after it
+		pos += i;
+	}
+	return pos;
+}
+
+/**
+ * Return the start of the run of characters ending at pos for which predicate is true.
+ * As ForwardWhile but DBCS is always examined a character at a time since trail bytes
+ * may look like ASCII.
+ */
+template <typename Predicate>
+Sci::Position Document::BackwardWhile(Sci::Position pos, Predicate predicate) const {
+	if (dbcsCodePage && (SC_CP_UTF8 != dbcsCodePage)) {
+		while (pos > 0) {
+			const CharacterExtracted ce = CharacterBefore(pos);
+			if (!predicate(ce.character))
+				break;
+			pos -= ce.widthBytes;
+		}
+		return pos;
+	}
+	char buffer[scanBlockSize];
+	while (pos > 0) {
+		const Sci::Position lengthBlock = std::min(scanBlockSize, pos);
+		const Sci::Position startBlock = pos - lengthBlock;
+		cb.GetCharRange(buffer, startBlock, lengthBlock);
+		while (pos > startBlock) {
+			const unsigned char ch = buffer[pos - 1 - startBlock];
+			if (!dbcsCodePage || UTF8IsAscii(ch)) {
+				if (!predicate(ch))
+					return pos;
+				pos--;
+			} else {
+				const CharacterExtracted ce = CharacterBefore(pos);
+				if (!predicate(ce.character))
+					return pos;
+				pos -= ce.widthBytes;
+			}
+		}
+	}
+	return pos;
+}
+
+Sci::Position Document::ForwardOverClass(Sci::Position pos, CharClassify::cc ccSkip) const {
+	return ForwardWhile(pos, [this, ccSkip](unsigned int ch) {
+		return WordCharacterClass(ch) == ccSkip;
+	});
+}
+
+Sci::Position Document::BackwardOverClass(Sci::Position pos, CharClassify::cc ccSkip) const {
+	return BackwardWhile(pos, [this, ccSkip](unsigned int ch) {
+		return WordCharacterClass(ch) == ccSkip;
+	});
+}
+
 /**
  * Used by commmands that want to select whole words.
  * Finds the start of word at pos when delta < 0 or the end of the word when delta >= 0.
@@ -1743,23 +1941,13 @@ Sci::Position Document::ExtendWordSelect(Sci::Position pos, int delta, bool only
 			const CharacterExtracted ce = CharacterBefore(pos);
 			ccStart = WordCharacterClass(ce.character);
 		}
-		while (pos > 0) {
-			const CharacterExtracted ce = CharacterBefore(pos);
-			if (WordCharacterClass(ce.character) != ccStart)
-				break;
-			pos -= ce.widthBytes;
-		}
+		pos = BackwardOverClass(pos, ccStart);
 	} else {
 		if (!onlyWordCharacters && pos < Length()) {
 			const CharacterExtracted ce = CharacterAfter(pos);
 			ccStart = WordCharacterClass(ce.character);
 		}
-		while (pos < Length()) {
-			const CharacterExtracted ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != ccStart)
-				break;
-			pos += ce.widthBytes;
-		}
+		pos = ForwardOverClass(pos, ccStart);
 	}
 	return MovePositionOutsideChar(pos, delta, true);
 }
@@ -1773,37 +1961,15 @@ Sci::Position Document::ExtendWordSelect(Sci::Position pos, int delta, bool only
  */
 Sci::Position Document::NextWordStart(Sci::Position pos, int delta) const {
 	if (delta < 0) {
-		while (pos > 0) {
-			const CharacterExtracted ce = CharacterBefore(pos);
-			if (WordCharacterClass(ce.character) != CharClassify::ccSpace)
-				break;
-			pos -= ce.widthBytes;
-		}
+		pos = BackwardOverClass(pos, CharClassify::ccSpace);
 		if (pos > 0) {
-			CharacterExtracted ce = CharacterBefore(pos);
-			const CharClassify::cc ccStart = WordCharacterClass(ce.character);
-			while (pos > 0) {
-				ce = CharacterBefore(pos);
-				if (WordCharacterClass(ce.character) != ccStart)
-					break;
-				pos -= ce.widthBytes;
-			}
+			const CharacterExtracted ce = CharacterBefore(pos);
+			pos = BackwardOverClass(pos, WordCharacterClass(ce.character));
 		}
 	} else {
-		CharacterExtracted ce = CharacterAfter(pos);
-		const CharClassify::cc ccStart = WordCharacterClass(ce.character);
-		while (pos < Length()) {
-			ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != ccStart)
-				break;
-			pos += ce.widthBytes;
-		}
-		while (pos < Length()) {
-			ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != CharClassify::ccSpace)
-				break;
-			pos += ce.widthBytes;
-		}
+		const CharacterExtracted ce = CharacterAfter(pos);
+		pos = ForwardOverClass(pos, WordCharacterClass(ce.character));
+		pos = ForwardOverClass(pos, CharClassify::ccSpace);
 	}
 	return pos;
 }
@@ -1818,39 +1984,18 @@ Sci::Position Document::NextWordStart(Sci::Position pos, int delta) const {
 Sci::Position Document::NextWordEnd(Sci::Position pos, int delta) const {
 	if (delta < 0) {
 		if (pos > 0) {
-			CharacterExtracted ce = CharacterBefore(pos);
+			const CharacterExtracted ce = CharacterBefore(pos);
 			const CharClassify::cc ccStart = WordCharacterClass(ce.character);
 			if (ccStart != CharClassify::ccSpace) {
-				while (pos > 0) {
-					ce = CharacterBefore(pos);
-					if (WordCharacterClass(ce.character) != ccStart)
-						break;
-					pos -= ce.widthBytes;
-				}
-			}
-			while (pos > 0) {
-				ce = CharacterBefore(pos);
-				if (WordCharacterClass(ce.character) != CharClassify::ccSpace)
-					break;
-				pos -= ce.widthBytes;
+				pos = BackwardOverClass(pos, ccStart);
 			}
+			pos = BackwardOverClass(pos, CharClassify::ccSpace);
 		}
 	} else {
-		while (pos < Length()) {
-			const CharacterExtracted ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != CharClassify::ccSpace)
-				break;
-			pos += ce.widthBytes;
-		}
+		pos = ForwardOverClass(pos, CharClassify::ccSpace);
 		if (pos < Length()) {
-			CharacterExtracted ce = CharacterAfter(pos);
-			const CharClassify::cc ccStart = WordCharacterClass(ce.character);
-			while (pos < Length()) {
-				ce = CharacterAfter(pos);
-				if (WordCharacterClass(ce.character) != ccStart)
-					break;
-				pos += ce.widthBytes;
-			}
+			const CharacterExtracted ce = CharacterAfter(pos);
+			pos = ForwardOverClass(pos, WordCharacterClass(ce.character));
 		}
 	}
 	return pos;
@@ -2487,38 +2632,37 @@ Sci::Position Document::WordPartLeft(Sci::Position pos) const {
 
 Sci::Position Document::WordPartRight(Sci::Position pos) const {
 	CharacterExtracted ceStart = CharacterAfter(pos);
-	const Sci::Position length = Length();
 	if (IsWordPartSeparator(ceStart.character)) {
-		while (pos < length && IsWordPartSeparator(CharacterAfter(pos).character))
-			pos += CharacterAfter(pos).widthBytes;
+		pos = ForwardWhile(pos, [this](unsigned int ch) {
+			return IsWordPartSeparator(ch);
+		});
 		ceStart = CharacterAfter(pos);
 	}
 	if (!IsASCII(ceStart.character)) {
-		while (pos < length && !IsASCII(CharacterAfter(pos).character))
-			pos += CharacterAfter(pos).widthBytes;
+		pos = ForwardWhile(pos, [](unsigned int ch) {
+			return !IsASCII(ch);
+		});
 	} else if (IsLowerCase(ceStart.character)) {
-		while (pos < length && IsLowerCase(CharacterAfter(pos).character))
-			pos += CharacterAfter(pos).widthBytes;
+		pos = ForwardWhile(pos, IsLowerCase);
 	} else if (IsUpperCase(ceStart.character)) {
 		if (IsLowerCase(CharacterAfter(pos + ceStart.widthBytes).character)) {
 			pos += CharacterAfter(pos).widthBytes;
-			while (pos < length && IsLowerCase(CharacterAfter(pos).character))
-				pos += CharacterAfter(pos).widthBytes;
+			pos = ForwardWhile(pos, IsLowerCase);
 		} else {
-			while (pos < length && IsUpperCase(CharacterAfter(pos).character))
-				pos += CharacterAfter(pos).widthBytes;
+			pos = ForwardWhile(pos, IsUpperCase);
 		}
 		if (IsLowerCase(CharacterAfter(pos).character) && IsUpperCase(CharacterBefore(pos).character))
 			pos -= CharacterBefore(pos).widthBytes;
 	} else if (IsADigit(ceStart.character)) {
-		while (pos < length && IsADigit(CharacterAfter(pos).character))
-			pos += CharacterAfter(pos).widthBytes;
+		pos = ForwardWhile(pos, [](unsigned int ch) {
+			return IsADigit(ch);
+		});
 	} else if (IsASCIIPunctuationCharacter(ceStart.character)) {
-		while (pos < length && IsASCIIPunctuationCharacter(CharacterAfter(pos).character))
-			pos += CharacterAfter(pos).widthBytes;
+		pos = ForwardWhile(pos, IsASCIIPunctuationCharacter);
 	} else if (isspacechar(ceStart.character)) {
-		while (pos < length && isspacechar(CharacterAfter(pos).character))
-			pos += CharacterAfter(pos).widthBytes;
+		pos = ForwardWhile(pos, [](unsigned int ch) {
+			return isspacechar(ch);
+		});
 	} else {
 		pos += CharacterAfter(pos).widthBytes;
 	}
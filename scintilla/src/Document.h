@@ -189,6 +189,17 @@ struct RegexError : public std::runtime_error {
 	RegexError() : std::runtime_error("regex failure") {}
 };
 
+/**
+ * The leading spaces and tabs of a line.
+ */
+struct LineIndentation {
+	Sci::Position position;	///< Position of the first character that is not a space or tab
+	int indent;	///< Column of that character
+	bool white;	///< The line contains only spaces and tabs
+	LineIndentation() noexcept : position(0), indent(0), white(true) {
+	}
+};
+
 /**
  */
 class Document : PerLine, public IDocument, public ILoader {
@@ -231,6 +242,12 @@ private:
 	LineAnnotation *Margins() const;
 	LineAnnotation *Annotations() const;
 
+	// Indentation of a range of lines for repeated queries while drawing
+	std::vector<LineIndentation> indentationCache;
+	Sci::Line indentationCacheLine;
+	int indentationCacheVersion;
+	int indentationCacheTabInChars;
+
 	bool matchesValid;
 	std::unique_ptr<RegexSearchBase> regex;
 	std::unique_ptr<LexInterface> pli;
@@ -350,6 +367,8 @@ public:
 	int SCI_METHOD GetLineIndentation(Sci_Position line) override;
 	Sci::Position SetLineIndentation(Sci::Line line, Sci::Position indent);
 	Sci::Position GetLineIndentPosition(Sci::Line line) const;
+	void GetLinesIndentation(Sci::Line lineFirst, Sci::Line lineLast, LineIndentation *indentations) const;
+	LineIndentation CachedLineIndentation(Sci::Line line);
 	Sci::Position GetColumn(Sci::Position pos);
 	Sci::Position CountCharacters(Sci::Position startPos, Sci::Position endPos) const;
 	Sci::Position CountUTF16(Sci::Position startPos, Sci::Position endPos) const;
@@ -374,6 +393,12 @@ public:
 	void GetStyleRange(unsigned char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const {
 		cb.GetStyleRange(buffer, position, lengthRetrieve);
 	}
+	int TextVersion() const noexcept { return cb.Version(); }
+	std::shared_ptr<const TextSnapshot> Snapshot() { return cb.Snapshot(); }
+	ITextSnapshot *CreateTextSnapshot();
+	bool EditsSince(int versionSince, std::vector<TextEdit> &edits) const {
+		return cb.EditsSince(versionSince, edits);
+	}
 	int GetMark(Sci::Line line) const;
 	Sci::Line MarkerNext(Sci::Line lineStart, int mask) const;
 	int AddMark(Sci::Line line, int markerNum);
@@ -470,6 +495,13 @@ private:
 	void NotifyModifyAttempt();
 	void NotifySavePoint(bool atSavePoint);
 	void NotifyModified(DocModification mh);
+	template <typename Predicate>
+	Sci::Position ForwardWhile(Sci::Position pos, Predicate predicate) const;
+	template <typename Predicate>
+	Sci::Position BackwardWhile(Sci::Position pos, Predicate predicate) const;
+	Sci::Position ForwardOverClass(Sci::Position pos, CharClassify::cc ccSkip) const;
+	Sci::Position BackwardOverClass(Sci::Position pos, CharClassify::cc ccSkip) const;
+	LineIndentation IndentationOfLine(Sci::Line line) const;
 };
 
 class UndoGroup {
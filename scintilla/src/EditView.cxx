@@ -70,6 +70,56 @@ PrintParameters::PrintParameters() {
 	wrapState = eWrapWord;
 }
 
+PageBreakCache::PageBreakCache() :
+	width(0), height(0), magnification(0), wrapState(eWrapNone), logPixelsY(0), tabInChars(0) {
+}
+
+void PageBreakCache::Clear() {
+	pageBreaks.clear();
+}
+
+void PageBreakCache::Invalidate(Sci::Position position) {
+	// A page that ends inside a wrapped line may break differently when the character
+	// after it changes. Pages ending at a line start only depend on earlier text.
+	pageBreaks.erase(std::remove_if(pageBreaks.begin(), pageBreaks.end(),
+		[position](const PageBreak &pb) noexcept {
+			return (pb.end > position) || ((pb.end == position) && !pb.endAtLineStart);
+		}), pageBreaks.end());
+}
+
+void PageBreakCache::SetParameters(int width_, int height_, const PrintParameters &printParameters, int logPixelsY_, int tabInChars_) {
+	if ((width != width_) || (height != height_) ||
+		(magnification != printParameters.magnification) || (wrapState != printParameters.wrapState) ||
+		(logPixelsY != logPixelsY_) || (tabInChars != tabInChars_)) {
+		width = width_;
+		height = height_;
+		magnification = printParameters.magnification;
+		wrapState = printParameters.wrapState;
+		logPixelsY = logPixelsY_;
+		tabInChars = tabInChars_;
+		Clear();
+	}
+}
+
+Sci::Position PageBreakCache::Find(Sci::Position start, Sci::Position endRange) const {
+	const auto it = std::lower_bound(pageBreaks.begin(), pageBreaks.end(), start,
+		[](const PageBreak &pb, Sci::Position pos) noexcept { return pb.start < pos; });
+	if ((it != pageBreaks.end()) && (it->start == start) && (it->endRange == endRange))
+		return it->end;
+	return -1;
+}
+
+void PageBreakCache::Add(Sci::Position start, Sci::Position endRange, Sci::Position end, bool endAtLineStart) {
+	const PageBreak pb = { start, endRange, end, endAtLineStart };
+	auto it = std::lower_bound(pageBreaks.begin(), pageBreaks.end(), start,
+		[](const PageBreak &pbLow, Sci::Position pos) noexcept { return pbLow.start < pos; });
+	if ((it != pageBreaks.end()) && (it->start == start)) {
+		*it = pb;
+	} else {
+		pageBreaks.insert(it, pb);
+	}
+}
+
 namespace Scintilla {
 
 bool ValidStyledText(const ViewStyle &vs, size_t styleOffset, const StyledText &st) {
@@ -1957,19 +2007,20 @@ void EditView::DrawIndentGuidesOverEmpty(Surface *surface, const EditModel &mode
 	if ((vsDraw.viewIndentationGuides == ivLookForward || vsDraw.viewIndentationGuides == ivLookBoth)
 		&& (subLine == 0)) {
 		const Sci::Position posLineStart = model.pdoc->LineStart(line);
-		int indentSpace = model.pdoc->GetLineIndentation(line);
-		int xStartText = static_cast<int>(ll->positions[model.pdoc->GetLineIndentPosition(line) - posLineStart]);
+		const LineIndentation indentationLine = model.pdoc->CachedLineIndentation(line);
+		int indentSpace = indentationLine.indent;
+		int xStartText = static_cast<int>(ll->positions[indentationLine.position - posLineStart]);
 
 		// Find the most recent line with some text
 
 		Sci::Line lineLastWithText = line;
-		while (lineLastWithText > std::max(line - 20, static_cast<Sci::Line>(0)) && model.pdoc->IsWhiteLine(lineLastWithText)) {
+		while (lineLastWithText > std::max(line - 20, static_cast<Sci::Line>(0)) && model.pdoc->CachedLineIndentation(lineLastWithText).white) {
 			lineLastWithText--;
 		}
 		if (lineLastWithText < line) {
 			xStartText = 100000;	// Don't limit to visible indentation on empty line
 			// This line is empty, so use indentation of last line with text
-			int indentLastWithText = model.pdoc->GetLineIndentation(lineLastWithText);
+			int indentLastWithText = model.pdoc->CachedLineIndentation(lineLastWithText).indent;
 			const int isFoldHeader = model.pdoc->GetLevel(lineLastWithText) & SC_FOLDLEVELHEADERFLAG;
 			if (isFoldHeader) {
 				// Level is one more level than parent
@@ -1986,14 +2037,14 @@ void EditView::DrawIndentGuidesOverEmpty(Surface *surface, const EditModel &mode
 		}
 
 		Sci::Line lineNextWithText = line;
-		while (lineNextWithText < std::min(line + 20, model.pdoc->LinesTotal()) && model.pdoc->IsWhiteLine(lineNextWithText)) {
+		while (lineNextWithText < std::min(line + 20, model.pdoc->LinesTotal()) && model.pdoc->CachedLineIndentation(lineNextWithText).white) {
 			lineNextWithText++;
 		}
 		if (lineNextWithText > line) {
 			xStartText = 100000;	// Don't limit to visible indentation on empty line
 			// This line is empty, so use indentation of first next line with text
 			indentSpace = std::max(indentSpace,
-				model.pdoc->GetLineIndentation(lineNextWithText));
+				model.pdoc->CachedLineIndentation(lineNextWithText).indent);
 		}
 
 		for (int indentPos = model.pdoc->IndentSize(); indentPos < indentSpace; indentPos += model.pdoc->IndentSize()) {
@@ -2351,6 +2402,17 @@ static ColourDesired InvertedLight(ColourDesired orig) {
 
 Sci::Position EditView::FormatRange(bool draw, const Sci_RangeToFormat *pfr, Surface *surface, Surface *surfaceMeasure,
 	const EditModel &model, const ViewStyle &vs) {
+	const Sci::Position startPrint = static_cast<Sci::Position>(pfr->chrg.cpMin);
+	const Sci::Position endRange = static_cast<Sci::Position>(pfr->chrg.cpMax);
+	pageBreaks.SetParameters(pfr->rc.right - pfr->rc.left, pfr->rc.bottom - pfr->rc.top, printParameters,
+		surfaceMeasure->LogPixelsY(), model.pdoc->tabInChars);
+	if (!draw) {
+		// Already measured this page so avoid laying it out again
+		const Sci::Position endPage = pageBreaks.Find(startPrint, endRange);
+		if (endPage >= 0)
+			return endPage;
+	}
+
 	// Can't use measurements cached for screen
 	posCache.Clear();
 
@@ -2530,5 +2592,8 @@ Sci::Position EditView::FormatRange(bool draw, const Sci_RangeToFormat *pfr, Sur
 	// Clear cache so measurements are not used for screen
 	posCache.Clear();
 
+	pageBreaks.Add(startPrint, endRange, nPrintPos,
+		nPrintPos == model.pdoc->LineStart(model.pdoc->SciLineFromPosition(nPrintPos)));
+
 	return nPrintPos;
 }
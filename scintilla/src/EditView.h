@@ -42,6 +42,35 @@ void DrawStyledText(Surface *surface, const ViewStyle &vs, int styleOffset, PRec
 
 typedef void (*DrawTabArrowFn)(Surface *surface, PRectangle rcTab, int ymid);
 
+/**
+* Remembers where each page measured by FormatRange ends so that measuring it again,
+* as when counting pages for printing and then for a preview, does not lay it out again.
+* Page breaks are discarded when the page size or print settings change and from the
+* point where the text or its styles change.
+*/
+class PageBreakCache {
+	struct PageBreak {
+		Sci::Position start;
+		Sci::Position endRange;
+		Sci::Position end;
+		bool endAtLineStart;
+	};
+	int width;
+	int height;
+	int magnification;
+	WrapMode wrapState;
+	int logPixelsY;
+	int tabInChars;
+	std::vector<PageBreak> pageBreaks;
+public:
+	PageBreakCache();
+	void Clear();
+	void Invalidate(Sci::Position position);
+	void SetParameters(int width_, int height_, const PrintParameters &printParameters, int logPixelsY_, int tabInChars_);
+	Sci::Position Find(Sci::Position start, Sci::Position endRange) const;
+	void Add(Sci::Position start, Sci::Position endRange, Sci::Position end, bool endAtLineStart);
+};
+
 class LineTabstops;
 
 /**
@@ -80,6 +109,7 @@ public:
 
 	LineLayoutCache llc;
 	PositionCache posCache;
+	PageBreakCache pageBreaks;
 
 	int tabArrowHeight; // draw arrow heads this many pixels above/below line midpoint
 	/** Some platforms, notably PLAT_CURSES, do not support Scintilla's native
@@ -273,6 +273,7 @@ void Editor::InvalidateStyleData() {
 	AllocateGraphics();
 	view.llc.Invalidate(LineLayout::llInvalid);
 	view.posCache.Clear();
+	view.pageBreaks.Clear();
 }
 
 void Editor::InvalidateStyleRedraw() {
@@ -2151,10 +2152,8 @@ void Editor::PasteRectangular(SelectionPosition pos, const char *ptr, Sci::Posit
 			if ((ptr[i] == '\r') || (!prevCr))
 				line++;
 			if (line >= pdoc->LinesTotal()) {
-				if (pdoc->eolMode != SC_EOL_LF)
-					pdoc->InsertString(pdoc->Length(), "\r", 1);
-				if (pdoc->eolMode != SC_EOL_CR)
-					pdoc->InsertString(pdoc->Length(), "\n", 1);
+				const char *eol = StringFromEOLMode(pdoc->eolMode);
+				pdoc->InsertString(pdoc->Length(), eol, strlen(eol));
 			}
 			// Pad the end of lines with spaces if required
 			sel.RangeMain().caret.SetPosition(PositionFromLineX(line, xInsert));
@@ -2167,9 +2166,14 @@ void Editor::PasteRectangular(SelectionPosition pos, const char *ptr, Sci::Posit
 			}
 			prevCr = ptr[i] == '\r';
 		} else {
-			const Sci::Position lengthInserted = pdoc->InsertString(sel.MainCaret(), ptr + i, 1);
+			// Insert the text up to the next line end as a single piece
+			Sci::Position end = i + 1;
+			while ((end < len) && !IsEOLChar(ptr[end]))
+				end++;
+			const Sci::Position lengthInserted = pdoc->InsertString(sel.MainCaret(), ptr + i, end - i);
 			sel.RangeMain().caret.Add(lengthInserted);
 			prevCr = false;
+			i = end - 1;
 		}
 	}
 	SetEmptySelection(pos);
@@ -2534,6 +2538,9 @@ static inline Sci::Position MovePositionForDeletion(Sci::Position position, Sci:
 
 void Editor::NotifyModified(Document *, DocModification mh, void *) {
 	ContainerNeedsUpdate(SC_UPDATE_CONTENT);
+	if (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT | SC_MOD_CHANGESTYLE)) {
+		view.pageBreaks.Invalidate(mh.position);
+	}
 	if (paintState == painting) {
 		CheckForChangeOutsidePaint(Range(mh.position, mh.position + mh.length));
 	}
@@ -4158,9 +4165,7 @@ std::string Editor::RangeText(Sci::Position start, Sci::Position end) const {
 	if (start < end) {
 		const Sci::Position len = end - start;
 		std::string ret(len, '\0');
-		for (int i = 0; i < len; i++) {
-			ret[i] = pdoc->CharAt(start + i);
-		}
+		pdoc->GetCharRange(&ret[0], start, len);
 		return ret;
 	}
 	return std::string();
@@ -4178,24 +4183,40 @@ void Editor::CopySelectionRange(SelectionText *ss, bool allowLineCopy) {
 				text.push_back('\r');
 			if (pdoc->eolMode != SC_EOL_CR)
 				text.push_back('\n');
-			ss->Copy(text, pdoc->dbcsCodePage,
+			ss->Copy(std::move(text), pdoc->dbcsCodePage,
 				vs.styles[STYLE_DEFAULT].characterSet, false, true);
 		}
 	} else {
-		std::string text;
 		std::vector<SelectionRange> rangesInOrder = sel.RangesCopy();
 		if (sel.selType == Selection::selRectangle)
 			std::sort(rangesInOrder.begin(), rangesInOrder.end());
+		std::string eol;
+		if (sel.selType == Selection::selRectangle) {
+			if (pdoc->eolMode != SC_EOL_LF)
+				eol.push_back('\r');
+			if (pdoc->eolMode != SC_EOL_CR)
+				eol.push_back('\n');
+		}
+		// Size the result once then fill it directly from the document so that
+		// copying a huge selection does not build and append temporary strings.
+		Sci::Position lengthText = 0;
 		for (const SelectionRange &current : rangesInOrder) {
-				text.append(RangeText(current.Start().Position(), current.End().Position()));
-			if (sel.selType == Selection::selRectangle) {
-				if (pdoc->eolMode != SC_EOL_LF)
-					text.push_back('\r');
-				if (pdoc->eolMode != SC_EOL_CR)
-					text.push_back('\n');
+			lengthText += current.End().Position() - current.Start().Position() + eol.length();
+		}
+		std::string text(lengthText, '\0');
+		Sci::Position offset = 0;
+		for (const SelectionRange &current : rangesInOrder) {
+			const Sci::Position lengthRange = current.End().Position() - current.Start().Position();
+			if (lengthRange > 0) {
+				pdoc->GetCharRange(&text[offset], current.Start().Position(), lengthRange);
+				offset += lengthRange;
+			}
+			if (!eol.empty()) {
+				memcpy(&text[offset], eol.c_str(), eol.length());
+				offset += eol.length();
 			}
 		}
-		ss->Copy(text, pdoc->dbcsCodePage,
+		ss->Copy(std::move(text), pdoc->dbcsCodePage,
 			vs.styles[STYLE_DEFAULT].characterSet, sel.IsRectangular(), sel.selType == Selection::selLines);
 	}
 }
@@ -4204,8 +4225,7 @@ void Editor::CopyRangeToClipboard(Sci::Position start, Sci::Position end) {
 	start = pdoc->ClampPositionIntoDocument(start);
 	end = pdoc->ClampPositionIntoDocument(end);
 	SelectionText selectedText;
-	std::string text = RangeText(start, end);
-	selectedText.Copy(text,
+	selectedText.Copy(RangeText(start, end),
 		pdoc->dbcsCodePage, vs.styles[STYLE_DEFAULT].characterSet, false, false);
 	CopyToClipboard(selectedText);
 }
@@ -5229,6 +5249,7 @@ void Editor::SetDocPointer(Document *document) {
 	pcs->InsertLines(0, pdoc->LinesTotal() - 1);
 	SetAnnotationHeights(0, pdoc->LinesTotal());
 	view.llc.Deallocate();
+	view.pageBreaks.Clear();
 	NeedWrapping();
 
 	hotspot = Range(Sci::invalidPosition);
@@ -7620,6 +7641,9 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 			return reinterpret_cast<sptr_t>(static_cast<ILoader *>(doc));
 		}
 
+	case SCI_CREATETEXTSNAPSHOT:
+		return reinterpret_cast<sptr_t>(pdoc->CreateTextSnapshot());
+
 	case SCI_SETMODEVENTMASK:
 		modEventMask = static_cast<int>(wParam);
 		return 0;
@@ -77,8 +77,8 @@ public:
 		codePage = 0;
 		characterSet = 0;
 	}
-	void Copy(const std::string &s_, int codePage_, int characterSet_, bool rectangular_, bool lineCopy_) {
-		s = s_;
+	void Copy(std::string s_, int codePage_, int characterSet_, bool rectangular_, bool lineCopy_) {
+		s = std::move(s_);
 		codePage = codePage_;
 		characterSet = characterSet_;
 		rectangular = rectangular_;
@@ -54,6 +54,8 @@ public:
 /// If interval not 0 length then each partition non-zero length
 /// When needed, positions after the interval are considered part of the last partition
 /// but the end of the last partition can be found with PositionFromPartition(last+1).
+/// PartitionFromPosition updates a search hint so, although const, it is not safe
+/// to call from more than one thread at a time on the same object.
 
 template <typename T>
 class Partitioning {
@@ -63,6 +65,18 @@ private:
 	T stepPartition;
 	T stepLength;
 	std::unique_ptr<SplitVectorWithRangeAdd<T>> body;
+	// Result of the previous PartitionFromPosition as queries are often
+	// for the same or nearby partitions. Only a hint so may be out of range.
+	// Written by const queries so concurrent readers need external locking.
+	mutable T partitionLastFound;
+
+	// Unchecked position of a partition that is known to be in range.
+	T PositionAt(T partition) const noexcept {
+		T pos = body->ValueAt(partition);
+		if (partition > stepPartition)
+			pos += stepLength;
+		return pos;
+	}
 
 	// Move step forward
 	void ApplyStep(T partitionUpTo) noexcept {
@@ -88,12 +102,13 @@ private:
 		body = std::make_unique<SplitVectorWithRangeAdd<T>>(growSize);
 		stepPartition = 0;
 		stepLength = 0;
+		partitionLastFound = 0;
 		body->Insert(0, 0);	// This value stays 0 for ever
 		body->Insert(1, 0);	// This is the end of the first partition and will be the start of the second
 	}
 
 public:
-	explicit Partitioning(int growSize) : stepPartition(0), stepLength(0) {
+	explicit Partitioning(int growSize) : stepPartition(0), stepLength(0), partitionLastFound(0) {
 		Allocate(growSize);
 	}
 
@@ -175,21 +190,33 @@ public:
 	T PartitionFromPosition(T pos) const noexcept {
 		if (body->Length() <= 1)
 			return 0;
-		if (pos >= (PositionFromPartition(Partitions())))
-			return Partitions() - 1;
+		const T partitions = Partitions();
+		if (pos >= (PositionFromPartition(partitions)))
+			return partitions - 1;
+		// Most queries are for the same or the next partition as the previous query
+		// so check those first as they are adjacent in memory.
+		const T hint = (partitionLastFound < partitions) ? partitionLastFound : partitions - 1;
+		if (pos >= PositionAt(hint)) {
+			if ((hint + 1 >= partitions) || (pos < PositionAt(hint + 1)))
+				return hint;
+			if ((hint + 2 >= partitions) || (pos < PositionAt(hint + 2))) {
+				partitionLastFound = hint + 1;
+				return hint + 1;
+			}
+		}
+		// Otherwise search the whole range so that the first few probes are always the
+		// same elements which then stay in the cache.
 		T lower = 0;
-		T upper = Partitions();
+		T upper = partitions;
 		do {
 			const T middle = (upper + lower + 1) / 2; 	// Round high
-			T posMiddle = body->ValueAt(middle);
-			if (middle > stepPartition)
-				posMiddle += stepLength;
-			if (pos < posMiddle) {
+			if (pos < PositionAt(middle)) {
 				upper = middle - 1;
 			} else {
 				lower = middle;
 			}
 		} while (lower < upper);
+		partitionLastFound = lower;
 		return lower;
 	}
 
@@ -0,0 +1,518 @@
+// Scintilla source code edit control
+/** @file LexFuzz.cxx
+ ** Feed lexers random and adversarial text without a user interface.
+ ** Styling built up through partial restyles and edits is compared with styling
+ ** the final text in one pass and the time taken as documents grow is measured
+ ** so that lexers which are inconsistent or super-linear can be found.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <chrono>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "LexerModule.h"
+#include "Catalogue.h"
+
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+
+#include "HeadlessDocument.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// Pieces of text that start or end constructs in many languages.
+const char *const fragments[] = {
+	" ", "  ", "\t", "\n", "\n", "\r\n", "\r", "\n\n",
+	"a", "x1", "_id", "Name", "if", "else", "end", "begin", "def", "function",
+	"return", "class", "int", "var", "$var", "${x}", "@x", "%h", "&amp;",
+	"0", "42", "3.14", "0x1F", "1e10", "0b101",
+	"\"", "'", "`", "\\", "\"\"\"", "'''", "\\\"",
+	"(", ")", "[", "]", "{", "}", "<", ">", "/", "*", "/*", "*/", "//",
+	"#", "--", ";", "%", "!", "=", "==", ":", ",", ".", "?", "|", "^", "~", "-", "+",
+	"<<EOF\n", "\nEOF\n", "<<'END'\n", "\nEND\n", "<<<X\n", "\nX;\n",
+	"<div>", "</div>", "<a href=\"", "<!--", "-->", "<?php ", "?>", "<%", "%>",
+	"<script>", "</script>", "<![CDATA[", "]]>",
+	"=begin\n", "\n=end\n", "=pod\n", "\n=cut\n", "#if 0\n", "#else\n", "#endif\n",
+	"#define X ", "@\"", "R\"(", ")\"", "[[", "]]", "(*", "*)",
+	"\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xff",
+};
+
+// Openers of constructs that run until a terminator which is never written.
+const char *const unterminated[] = {
+	"\"", "'", "`", "/*", "<<EOF\n", "<!--", "\"\"\"", "=begin\n", "<![CDATA[",
+	"#if 0\n", "[[", "(*", "<?php /*", "<script>'", "R\"(",
+};
+
+// Bracketing pairs for deep nesting.
+const char *const nesting[][2] = {
+	{"(", ")"}, {"[", "]"}, {"{", "}"}, {"<div>", "</div>"}, {"/*", "*/"},
+	{"begin\n", "end\n"}, {"if x then\n", "end if\n"}, {"<?php ", "?>"},
+	{"#if 1\n", "#endif\n"}, {"\"$(", ")\""},
+};
+
+// Turn on folding in most lexers so fold levels are checked as well as styles.
+const char *const foldProperties[] = {
+	"fold", "fold.comment", "fold.preprocessor", "fold.html", "fold.compact",
+};
+
+const char keyWords[] = "if else end begin def function return class int var while for then";
+
+// Edits that once left a lexer with different styles or fold levels than lexing from scratch.
+// The text is styled in one pass before the edit so the restyle starts part way through.
+// lengthDelete characters are removed at position before the insertion and property, when
+// present, is set to 1 for both documents.
+struct KnownEdit {
+	const char *lexer;
+	const char *text;
+	Sci_Position position;
+	const char *insertion;
+	Sci_Position lengthDelete = 0;
+	const char *property = nullptr;
+};
+
+const KnownEdit knownEdits[] = {
+	// Restyling from a setext underline started in the heading style
+	{"markdown", "text\nSetext\n---\nmore\nbody\n", 12, "-"},
+	{"markdown", "text\r\nSetext\r\n===\r\nmore\r\nbody\r\n", 14, "="},
+	// Resuming a script region that starts after "<% %>" on a line following a skipped "</" line end
+	{"hypertext", "<script>\na </\n>\n<script>\nvar x = 1;\nx = 2; <% a %> y = 3;\nz = 4;\n</script>\n",
+		38, "", 1, "lexer.html.script.lexers"},
+};
+
+const char *const shapeNames[] = {
+	"random", "nested", "longline", "unterminated",
+};
+constexpr int shapes = static_cast<int>(std::size(shapeNames));
+
+struct Options {
+	unsigned int seed = 1;
+	int documents = 20;
+	int edits = 10;
+	Sci_Position size = 4096;
+	Sci_Position sizeTiming = 32768;
+	int scale = 8;
+	double exponentLimit = 1.5;
+	bool check = true;
+	bool timing = true;
+	bool verbose = false;
+	std::vector<std::string> lexers;
+	std::vector<std::pair<std::string, std::string>> properties;
+	std::vector<std::string> corpus;
+	std::string failures;
+};
+
+/**
+ * Produces text and edits from a seed so that a failure can be repeated by
+ * running a single lexer with the same seed.
+ */
+class Generator {
+	std::mt19937 rng;
+	const std::vector<std::string> &corpus;
+public:
+	Generator(unsigned int seed, const std::vector<std::string> &corpus_) : rng(seed), corpus(corpus_) {
+	}
+	size_t Below(size_t limit) {
+		return std::uniform_int_distribution<size_t>(0, limit - 1)(rng);
+	}
+	const char *Fragment() {
+		return fragments[Below(std::size(fragments))];
+	}
+	std::string Random(Sci_Position size) {
+		std::string text;
+		while (static_cast<Sci_Position>(text.length()) < size) {
+			text += Fragment();
+		}
+		return text;
+	}
+	std::string Nested(Sci_Position size) {
+		const char *const *pair = nesting[Below(std::size(nesting))];
+		std::string text;
+		size_t depth = 0;
+		while (static_cast<Sci_Position>(text.length()) < size / 2) {
+			text += pair[0];
+			if (Below(4) == 0)
+				text += Fragment();
+			depth++;
+		}
+		for (; depth > 0; depth--) {
+			text += pair[1];
+		}
+		return text;
+	}
+	std::string LongLine(Sci_Position size) {
+		std::string text;
+		while (static_cast<Sci_Position>(text.length()) < size) {
+			const char *fragment = Fragment();
+			if (!strpbrk(fragment, "\r\n"))
+				text += fragment;
+		}
+		return text;
+	}
+	std::string Unterminated(Sci_Position size) {
+		std::string text = unterminated[Below(std::size(unterminated))];
+		while (static_cast<Sci_Position>(text.length()) < size) {
+			text += "abc def ghi";
+			text += (Below(8) == 0) ? "\n" : " ";
+		}
+		return text;
+	}
+	std::string Shape(int shape, Sci_Position size) {
+		switch (shape) {
+		case 1:
+			return Nested(size);
+		case 2:
+			return LongLine(size);
+		case 3:
+			return Unterminated(size);
+		default:
+			return Random(size);
+		}
+	}
+	/// A random shape or, when there is a corpus, a slice of one of its files.
+	std::string Text(Sci_Position size) {
+		if (!corpus.empty() && Below(2) == 0) {
+			const std::string &file = corpus[Below(corpus.size())];
+			const size_t start = file.empty() ? 0 : Below(file.length());
+			return file.substr(start, size);
+		}
+		return Shape(static_cast<int>(Below(shapes)), size);
+	}
+	void Edit(Document *pdoc) {
+		const Sci::Position length = pdoc->Length();
+		if ((length > 0) && (Below(3) == 0)) {
+			const Sci::Position position = Below(length);
+			pdoc->DeleteChars(position, std::min<Sci::Position>(Below(32) + 1, length - position));
+		} else {
+			std::string insertion;
+			for (size_t n = Below(4) + 1; n > 0; n--) {
+				insertion += Fragment();
+			}
+			pdoc->InsertString(Below(length + 1), insertion.c_str(), insertion.length());
+		}
+	}
+	/// Style up to end as a view would, a screen of lines at a time from the first
+	/// unstyled line.
+	void StyleInSteps(Document *pdoc, Sci::Position end) {
+		while (pdoc->GetEndStyled() < end) {
+			const Sci::Position endStyled = pdoc->GetEndStyled();
+			const Sci::Line lineStyled = pdoc->SciLineFromPosition(endStyled);
+			pdoc->EnsureStyledTo(pdoc->LineStart(lineStyled + Below(60) + 1));
+			// A lexer that stops short would otherwise be asked again forever
+			if (pdoc->GetEndStyled() <= endStyled)
+				break;
+		}
+	}
+};
+
+void Configure(HeadlessDocument &doc, const std::string &lexer, const Options &options) {
+	doc.SetLexerLanguage(lexer.c_str());
+	for (const char *property : foldProperties) {
+		doc.SetProperty(property, "1");
+	}
+	for (const auto &[key, value] : options.properties) {
+		doc.SetProperty(key.c_str(), value.c_str());
+	}
+	for (int keyWordSet = 0; keyWordSet <= KEYWORDSET_MAX; keyWordSet++) {
+		doc.SetKeyWords(keyWordSet, keyWords);
+	}
+}
+
+bool ReadFile(const char *path, std::string &text) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	char buffer[16384];
+	size_t lenBlock;
+	while ((lenBlock = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+		text.append(buffer, lenBlock);
+	}
+	fclose(fp);
+	return true;
+}
+
+/// Report the first difference between the edited document and one styled in one pass.
+/// @return true if the styles and fold levels are the same.
+bool Compare(const std::string &lexer, int document, HeadlessDocument &edited, HeadlessDocument &whole) {
+	const Document *pdoc = edited.GetDocument();
+	for (Sci_Position position = 0; position < edited.Length(); position++) {
+		if (edited.StyleAt(position) != whole.StyleAt(position)) {
+			printf("%s: document %d style differs at line %d position %d: %d edited, %d whole\n",
+				lexer.c_str(), document, static_cast<int>(pdoc->SciLineFromPosition(position)),
+				static_cast<int>(position), edited.StyleAt(position), whole.StyleAt(position));
+			return false;
+		}
+	}
+	for (Sci_Position line = 0; line < pdoc->LinesTotal(); line++) {
+		if (edited.FoldLevel(line) != whole.FoldLevel(line)) {
+			printf("%s: document %d fold level differs at line %d: %x edited, %x whole\n",
+				lexer.c_str(), document, static_cast<int>(line),
+				edited.FoldLevel(line), whole.FoldLevel(line));
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Style documents in steps with edits in between and compare with styling from scratch.
+/// @return the number of documents that differed.
+int CheckIncremental(const std::string &lexer, const Options &options) {
+	Generator generator(options.seed, options.corpus);
+	int failures = 0;
+	for (int document = 0; document < options.documents; document++) {
+		const std::string text = generator.Text(options.size);
+		HeadlessDocument edited;
+		Configure(edited, lexer, options);
+		edited.LoadText(text.c_str(), text.length());
+		Document *pdoc = edited.GetDocument();
+		generator.StyleInSteps(pdoc, pdoc->Length());
+		for (int edit = 0; edit < options.edits; edit++) {
+			generator.Edit(pdoc);
+			// Only the part of the document before the view may be styled after an edit
+			const Sci::Line lineView = generator.Below(pdoc->LinesTotal());
+			generator.StyleInSteps(pdoc, pdoc->LineStart(lineView));
+		}
+		generator.StyleInSteps(pdoc, pdoc->Length());
+
+		const std::string textEdited = edited.Text();
+		HeadlessDocument whole;
+		Configure(whole, lexer, options);
+		whole.LoadText(textEdited.c_str(), textEdited.length());
+		whole.Colourise();
+
+		if (!Compare(lexer, document, edited, whole)) {
+			failures++;
+			if (!options.failures.empty()) {
+				// Some lexer names, such as PL/M, are not valid file names
+				std::string name = lexer;
+				std::replace(name.begin(), name.end(), '/', '_');
+				const std::string path = options.failures + "/" + name + "-" +
+					std::to_string(options.seed) + "-" + std::to_string(document) + ".txt";
+				edited.SaveFile(path.c_str());
+			}
+		}
+	}
+	return failures;
+}
+
+/// Replay the known edits for a lexer and compare with styling from scratch.
+/// @return the number of edits that differed.
+int CheckKnownEdits(const std::string &lexer, const Options &options) {
+	int failures = 0;
+	int document = 0;
+	for (const KnownEdit &knownEdit : knownEdits) {
+		if (lexer != knownEdit.lexer)
+			continue;
+		HeadlessDocument edited;
+		Configure(edited, lexer, options);
+		if (knownEdit.property)
+			edited.SetProperty(knownEdit.property, "1");
+		edited.LoadText(knownEdit.text, strlen(knownEdit.text));
+		edited.Colourise();
+		edited.GetDocument()->DeleteChars(knownEdit.position, knownEdit.lengthDelete);
+		edited.GetDocument()->InsertString(knownEdit.position, knownEdit.insertion, strlen(knownEdit.insertion));
+		edited.Colourise();
+
+		const std::string textEdited = edited.Text();
+		HeadlessDocument whole;
+		Configure(whole, lexer, options);
+		if (knownEdit.property)
+			whole.SetProperty(knownEdit.property, "1");
+		whole.LoadText(textEdited.c_str(), textEdited.length());
+		whole.Colourise();
+
+		if (!Compare(lexer + " known edit", document, edited, whole))
+			failures++;
+		document++;
+	}
+	return failures;
+}
+
+/// The shortest of several runs as a single run is easily disturbed.
+double TimeColourise(const std::string &lexer, const std::string &text, const Options &options) {
+	double best = 0.0;
+	for (int run = 0; run < 3; run++) {
+		HeadlessDocument doc;
+		Configure(doc, lexer, options);
+		doc.LoadText(text.c_str(), text.length());
+		const auto start = std::chrono::steady_clock::now();
+		doc.Colourise();
+		const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+		if ((run == 0) || (duration.count() < best))
+			best = duration.count();
+	}
+	return best;
+}
+
+/// Time each shape at two sizes and print how time grows as a power of the size.
+/// @return the number of shapes that grew faster than the limit.
+int CheckGrowth(const std::string &lexer, const Options &options) {
+	// Below this, timer granularity and noise dominate the measurement.
+	constexpr double minimumDuration = 0.002;
+	Generator generator(options.seed, options.corpus);
+	int slow = 0;
+	printf("%s:", lexer.c_str());
+	for (int shape = 0; shape < shapes; shape++) {
+		const std::string large = generator.Shape(shape, options.sizeTiming * options.scale);
+		const std::string small = large.substr(0, options.sizeTiming);
+		const double durationSmall = TimeColourise(lexer, small, options);
+		const double durationLarge = TimeColourise(lexer, large, options);
+		const double exponent = (durationLarge < minimumDuration) ? 1.0 :
+			std::log(durationLarge / std::max(durationSmall, 1e-9)) /
+			std::log(static_cast<double>(large.length()) / small.length());
+		const bool tooSlow = exponent > options.exponentLimit;
+		printf(" %s %.2f%s", shapeNames[shape], exponent, tooSlow ? " SLOW" : "");
+		if (options.verbose)
+			printf(" (%.1fms)", durationLarge * 1000.0);
+		if (tooSlow)
+			slow++;
+	}
+	printf("\n");
+	return slow;
+}
+
+std::vector<std::string> AllLexers() {
+	std::vector<std::string> names;
+	// Lexers without a fixed number are numbered consecutively after SCLEX_AUTOMATIC.
+	for (int language = 0; ; language++) {
+		const LexerModule *lm = Catalogue::Find(language);
+		if (!lm && (language > SCLEX_AUTOMATIC))
+			break;
+		if (lm && lm->languageName)
+			names.push_back(lm->languageName);
+	}
+	return names;
+}
+
+void Usage() {
+	fprintf(stderr,
+		"Usage: lexFuzz [options] [lexer...]\n"
+		"  -s seed       random seed, default 1\n"
+		"  -d documents  documents for each lexer, default 20\n"
+		"  -e edits      edits to each document, default 10\n"
+		"  -z size       document size, default 4096\n"
+		"  -t size       smaller timing size, default 32768\n"
+		"  -x scale      larger timing size as a multiple of the smaller, default 8\n"
+		"  -g exponent   report growth faster than size^exponent, default 1.5\n"
+		"  -p key=value  set a lexer property\n"
+		"  -f file       start some documents from slices of a file\n"
+		"  -o directory  save documents that differ\n"
+		"  -c            only check edited against whole styling\n"
+		"  -T            only time\n"
+		"  -v            print times\n"
+		"  -l            list the lexers in the catalogue\n"
+		"With no lexers named, every lexer in the catalogue is run.\n");
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		const std::string_view arg = argv[i];
+		const bool hasValue = (i + 1) < argc;
+		if ((arg == "-s") && hasValue) {
+			options.seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+		} else if ((arg == "-d") && hasValue) {
+			options.documents = atoi(argv[++i]);
+		} else if ((arg == "-e") && hasValue) {
+			options.edits = atoi(argv[++i]);
+		} else if ((arg == "-z") && hasValue) {
+			options.size = atoi(argv[++i]);
+		} else if ((arg == "-t") && hasValue) {
+			options.sizeTiming = std::max(atoi(argv[++i]), 1);
+		} else if ((arg == "-x") && hasValue) {
+			options.scale = std::max(atoi(argv[++i]), 2);
+		} else if ((arg == "-g") && hasValue) {
+			options.exponentLimit = atof(argv[++i]);
+		} else if ((arg == "-p") && hasValue) {
+			const std::string property = argv[++i];
+			const size_t equals = property.find('=');
+			if (equals == std::string::npos) {
+				Usage();
+				return 2;
+			}
+			options.properties.emplace_back(property.substr(0, equals), property.substr(equals + 1));
+		} else if ((arg == "-f") && hasValue) {
+			std::string text;
+			if (!ReadFile(argv[++i], text)) {
+				fprintf(stderr, "Can not read %s\n", argv[i]);
+				return 2;
+			}
+			options.corpus.push_back(text);
+		} else if ((arg == "-o") && hasValue) {
+			options.failures = argv[++i];
+		} else if (arg == "-c") {
+			options.timing = false;
+		} else if (arg == "-T") {
+			options.check = false;
+		} else if (arg == "-v") {
+			options.verbose = true;
+		} else if (arg == "-l") {
+			for (const std::string &lexer : AllLexers()) {
+				printf("%s\n", lexer.c_str());
+			}
+			return 0;
+		} else if (arg[0] == '-') {
+			Usage();
+			return 2;
+		} else {
+			options.lexers.push_back(argv[i]);
+		}
+	}
+
+	HeadlessInitialise();
+	if (options.lexers.empty())
+		options.lexers = AllLexers();
+
+	int failures = 0;
+	int slow = 0;
+	for (const std::string &lexer : options.lexers) {
+		if (!Catalogue::Find(lexer.c_str())) {
+			fprintf(stderr, "No lexer %s\n", lexer.c_str());
+			return 2;
+		}
+		// Flush so that a lexer which crashes or hangs can be identified.
+		fflush(stdout);
+		if (options.check) {
+			// Known edits report their own differences
+			failures += CheckKnownEdits(lexer, options);
+			const int differed = CheckIncremental(lexer, options);
+			if (options.verbose || differed)
+				printf("%s: %d of %d documents differ\n", lexer.c_str(), differed, options.documents);
+			failures += differed;
+		}
+		if (options.timing)
+			slow += CheckGrowth(lexer, options);
+	}
+	printf("%d documents differ, %d shapes grow too fast, seed %u\n", failures, slow, options.seed);
+	return (failures || slow) ? 1 : 0;
+}
@@ -12,6 +12,7 @@ CXXFLAGS = /EHsc /std:c++latest /D_HAS_AUTO_PTR_ETC=1 /wd 4805 $(INCLUDEDIRS)
 TESTSRC=test*.cxx
 # Files being tested from scintilla/src directory
 TESTEDSRC=\
+ ../../lexlib/CharacterCategory.cxx \
  ../../lexlib/WordList.cxx \
  ../../src/CellBuffer.cxx \
  ../../src/CharClassify.cxx \
@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <cstring>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <algorithm>
@@ -144,4 +145,65 @@ TEST_CASE("CellBuffer") {
 		REQUIRE(cb.Length() == 0);
 	}
 
+	SECTION("Snapshot") {
+		REQUIRE(0 == cb.Version());
+		bool startSequence = false;
+		cb.InsertString(0, sText, sLength, startSequence);
+		REQUIRE(1 == cb.Version());
+		std::shared_ptr<const TextSnapshot> snapshot = cb.Snapshot();
+		REQUIRE(1 == snapshot->Version());
+		REQUIRE(sLength == snapshot->Length());
+		REQUIRE(snapshot->Text() == sText);
+		REQUIRE('S' == snapshot->CharAt(0));
+		REQUIRE('\0' == snapshot->CharAt(sLength));
+		// Unchanged so same snapshot
+		REQUIRE(snapshot == cb.Snapshot());
+
+		cb.DeleteChars(0, 3, startSequence);
+		REQUIRE(2 == cb.Version());
+		// Earlier snapshot is not affected by edits
+		REQUIRE(snapshot->Text() == sText);
+		REQUIRE(cb.Snapshot()->Text() == "ntilla");
+
+		std::vector<TextEdit> edits;
+		REQUIRE(cb.EditsSince(1, edits));
+		REQUIRE(1 == edits.size());
+		REQUIRE(0 == edits[0].position);
+		REQUIRE(3 == edits[0].lengthDeleted);
+		REQUIRE(0 == edits[0].lengthInserted);
+		REQUIRE(!cb.EditsSince(3, edits));
+	}
+
+	SECTION("SnapshotAfterEdits") {
+		bool startSequence = false;
+		const std::string text(300000, 'x');
+		cb.InsertString(0, text.c_str(), text.length(), startSequence);
+		std::shared_ptr<const TextSnapshot> snapshotBefore = cb.Snapshot();
+		unsigned int seed = 1;
+		for (int i = 0; i < 200; i++) {
+			seed = seed * 1103515245 + 12345;
+			const Sci::Position position = (seed >> 8) % (cb.Length() + 1);
+			if (seed & 1) {
+				cb.InsertString(position, sText, sLength, startSequence);
+			} else {
+				cb.DeleteChars(position, std::min<Sci::Position>(5, cb.Length() - position), startSequence);
+			}
+			if ((i % 7) == 0) {
+				std::shared_ptr<const TextSnapshot> snapshot = cb.Snapshot();
+				REQUIRE(cb.Length() == snapshot->Length());
+				std::string current(cb.Length(), '\0');
+				cb.GetCharRange(&current[0], 0, cb.Length());
+				REQUIRE(snapshot->Text() == current);
+				const Sci::Position middle = cb.Length() / 2;
+				char range[100] {};
+				snapshot->GetCharRange(range, middle, sizeof(range));
+				REQUIRE(memcmp(range, current.c_str() + middle, sizeof(range)) == 0);
+			}
+		}
+		REQUIRE(snapshotBefore->Text() == text);
+		std::vector<TextEdit> edits;
+		REQUIRE(cb.EditsSince(snapshotBefore->Version(), edits));
+		REQUIRE(cb.Version() - snapshotBefore->Version() == static_cast<int>(edits.size()));
+	}
+
 }
@@ -0,0 +1,53 @@
+// Unit Tests for Scintilla internal data structures
+
+#include "CharacterCategory.h"
+
+#include "catch.hpp"
+
+using namespace Scintilla;
+
+// Test CharacterCategory.
+
+TEST_CASE("CharacterCategory") {
+
+	SECTION("ASCII") {
+		REQUIRE(ccCc == CategoriseCharacter(0));
+		REQUIRE(ccZs == CategoriseCharacter(' '));
+		REQUIRE(ccNd == CategoriseCharacter('7'));
+		REQUIRE(ccLu == CategoriseCharacter('Q'));
+		REQUIRE(ccLl == CategoriseCharacter('q'));
+		REQUIRE(ccPc == CategoriseCharacter('_'));
+		REQUIRE(ccSm == CategoriseCharacter('+'));
+		REQUIRE(ccCc == CategoriseCharacter(0x7F));
+	}
+
+	SECTION("NonASCII") {
+		REQUIRE(ccZs == CategoriseCharacter(0xA0));	// NO-BREAK SPACE
+		REQUIRE(ccLu == CategoriseCharacter(0x391));	// GREEK CAPITAL LETTER ALPHA
+		REQUIRE(ccLl == CategoriseCharacter(0x3B1));	// GREEK SMALL LETTER ALPHA
+		REQUIRE(ccLo == CategoriseCharacter(0x4E00));	// CJK UNIFIED IDEOGRAPH-4E00
+		REQUIRE(ccZl == CategoriseCharacter(0x2028));	// LINE SEPARATOR
+		REQUIRE(ccCs == CategoriseCharacter(0xD800));
+		REQUIRE(ccCo == CategoriseCharacter(0xE000));
+		REQUIRE(ccSo == CategoriseCharacter(0x1F600));	// GRINNING FACE
+		REQUIRE(ccCo == CategoriseCharacter(0x10FFFD));
+	}
+
+	SECTION("Unassigned") {
+		REQUIRE(ccCn == CategoriseCharacter(0x378));
+		REQUIRE(ccCn == CategoriseCharacter(0xFFFF));
+		REQUIRE(ccCn == CategoriseCharacter(0x10FFFF));
+	}
+
+	SECTION("OutOfRange") {
+		REQUIRE(ccCn == CategoriseCharacter(-1));
+		REQUIRE(ccCn == CategoriseCharacter(0x110000));
+	}
+
+	SECTION("Identifiers") {
+		REQUIRE(IsXidStart(0x3B1));
+		REQUIRE(!IsXidStart('1'));
+		REQUIRE(IsXidContinue('1'));
+		REQUIRE(!IsXidContinue(0x2028));
+	}
+}
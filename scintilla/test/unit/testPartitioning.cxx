@@ -187,4 +187,46 @@ TEST_CASE("Partitioning") {
 		REQUIRE(11 == part.PartitionFromPosition(50));
 	}
 
+	SECTION("SearchFromPreviousResult") {
+		// Partitions of varying lengths with a step left in the middle
+		part.InsertText(0, 1000);
+		Sci::Position pos = 0;
+		for (int i=1; i<100; i++) {
+			pos += 1 + (i % 7);
+			part.InsertPartition(i, pos);
+		}
+		part.InsertText(50, 5);
+		std::vector<Sci::Position> starts;
+		for (int i=0; i<=part.Partitions(); i++) {
+			starts.push_back(part.PositionFromPartition(i));
+		}
+		auto expected = [&starts](Sci::Position position) {
+			Sci::Position partition = 0;
+			while ((partition < static_cast<Sci::Position>(starts.size()) - 2) && (starts[partition + 1] <= position))
+				partition++;
+			return partition;
+		};
+		// Forwards, backwards then jumping around so each search starts from a different hint
+		for (Sci::Position p=0; p<starts.back(); p++) {
+			REQUIRE(expected(p) == part.PartitionFromPosition(p));
+		}
+		for (Sci::Position p=starts.back()-1; p>=0; p--) {
+			REQUIRE(expected(p) == part.PartitionFromPosition(p));
+		}
+		for (Sci::Position p=0; p<starts.back(); p+=37) {
+			const Sci::Position mirrored = starts.back() - 1 - p;
+			REQUIRE(expected(mirrored) == part.PartitionFromPosition(mirrored));
+			REQUIRE(expected(p) == part.PartitionFromPosition(p));
+		}
+		REQUIRE(0 == part.PartitionFromPosition(-1));
+		REQUIRE(part.Partitions() - 1 == part.PartitionFromPosition(starts.back() + 10));
+		// Previous result beyond the end after partitions removed
+		REQUIRE(99 == part.PartitionFromPosition(starts.back() - 1));
+		for (int i=99; i>10; i--) {
+			part.RemovePartition(i);
+		}
+		REQUIRE(10 == part.PartitionFromPosition(starts[10]));
+		REQUIRE(9 == part.PartitionFromPosition(starts[10] - 1));
+	}
+
 }